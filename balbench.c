@@ -0,0 +1,79 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+// Load balancing under uneven bursts of CPU-bound work.
+// Burst 1 forks 2 spinners per CPU; every other one stops after
+// a short run, which leaves the long ones bunched up on some CPUs
+// until the balancer spreads them out.  Burst 2 adds one nice 5
+// spinner per CPU halfway through.  Every interval ticks it prints
+//   balbench t=T cpu0=U0 ... migrations=M tickskips=S
+// with Ui the utilization of CPU i in percent over the interval and
+// S the timer ticks that left a process alone on its CPU running.
+//
+// Usage: balbench [interval [duration]]
+
+static struct cpustat st[NCPU], prev[NCPU];
+
+static void
+spinner(int nice1, int ticks)
+{
+  int end;
+
+  if(nice1)
+    nice(getpid(), nice1);
+  end = uptime() + ticks;
+  while(uptime() < end)
+    ;
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int interval = 10, duration = 300;
+  int ncpu, nproc, i, t, start, migrations, skips;
+  unsigned long long ns, prevns;
+  uint dt;
+
+  if(argc > 1)
+    interval = atoi(argv[1]);
+  if(argc > 2)
+    duration = atoi(argv[2]);
+  ncpu = cpustat(prev, NCPU);
+
+  nproc = 0;
+  for(i = 0; i < 2*ncpu; i++, nproc++)
+    if(fork() == 0)
+      spinner(0, i % 2 ? duration * 2 / 3 : duration / 6);
+
+  start = uptime();
+  nanouptime(&prevns);
+  for(t = interval; t <= duration; t += interval){
+    if(t > duration / 2 && t - interval <= duration / 2)
+      for(i = 0; i < ncpu; i++, nproc++)
+        if(fork() == 0)
+          spinner(5, duration / 6);
+    sleep(start + t - uptime());
+    cpustat(st, NCPU);
+    nanouptime(&ns);
+    dt = ns - prevns;
+    printf(1, "balbench t=%d", t);
+    migrations = skips = 0;
+    for(i = 0; i < ncpu; i++){
+      // Deltas fit in 32 bits for intervals under 4 seconds.
+      printf(1, " cpu%d=%d", i, dt ? (uint)(st[i].busy - prev[i].busy) / (dt / 100 + 1) : 0);
+      migrations += st[i].nmigrate - prev[i].nmigrate;
+      skips += st[i].ntickskip - prev[i].ntickskip;
+      prev[i] = st[i];
+    }
+    printf(1, " migrations=%d tickskips=%d\n", migrations, skips);
+    prevns = ns;
+  }
+
+  for(i = 0; i < nproc; i++)
+    wait();
+  exit();
+}
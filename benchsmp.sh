@@ -0,0 +1,23 @@
+#!/bin/sh
+# Boot xv6 under QEMU once per CPU count, run one command at the
+# shell prompt, and print the result lines it reports (lines that
+# start with the program name), prefixed with the CPU count.
+#
+# Usage: ./benchsmp.sh "command args" [cpus ...]
+#   e.g. ./benchsmp.sh "lockbench 8 200" 1 2 4 8
+# WAIT (seconds, default 30) bounds how long each run may take.
+
+cmd=$1
+shift
+[ -n "$cmd" ] || { echo "usage: $0 \"command args\" [cpus ...]" 1>&2; exit 1; }
+[ $# -gt 0 ] || set -- 1 2 4 8
+WAIT=${WAIT:-30}
+prog=${cmd%% *}
+
+make fs.img xv6.img >/dev/null || exit 1
+for n in "$@"; do
+  # Type the command once the shell is up, then quit QEMU with ^A x.
+  ( sleep 5; echo "$cmd"; sleep "$WAIT"; printf '\001x' ) |
+    timeout $((WAIT + 20)) make -s qemu-nox CPUS="$n" 2>/dev/null |
+    tr -d '\r' | grep "^$prog " | sed "s/^/cpus=$n /"
+done
@@ -0,0 +1,10 @@
+// 4 MB pages.  With CR4.PSE on (entry.S sets it), a page directory
+// entry with PTE_PS maps BIGPGSIZE bytes of physical memory directly,
+// without a page table, and takes a single TLB entry.
+
+#define BIGPGSIZE  (1 << PDXSHIFT)
+#define BIGPGADDR(pde)  ((uint)(pde) & ~(BIGPGSIZE-1))
+
+// kalloc.c
+char* kallocbig(void);
+void kfreebig(char*);
@@ -0,0 +1,215 @@
+// Buffer cache.
+//
+// The buffer cache holds cached copies of disk block contents.
+// Caching disk blocks in memory reduces the number of disk reads
+// and also provides a synchronization point for disk blocks used
+// by multiple processes.
+//
+// Interface:
+// * To get a buffer for a particular disk block, call bread.
+// * After changing buffer data, call bwrite to write it to disk.
+// * When done with the buffer, call brelse.
+// * Do not use the buffer after calling brelse.
+// * Only one process at a time can use a buffer,
+//     so do not keep them longer than necessary.
+//
+// Buffers are found through a hash table keyed by (dev, blockno),
+// chained through b->next.  Each bucket has its own spin lock, so
+// lookups of different blocks from different CPUs do not contend,
+// and a hit takes only its bucket's lock.  A miss takes evictlock,
+// which serializes misses, and recycles the unused buffer released
+// longest ago.  While scanning for it, the evictor holds at most two
+// bucket locks, taken in bucket order.
+//
+// The implementation uses two state flags internally:
+// * B_VALID: the buffer data has been read from the disk.
+// * B_DIRTY: the buffer data has been modified
+//     and needs to be written to disk.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "buf.h"
+
+#define NBUCKET 13  // Prime, so runs of block numbers spread out
+#define HASH(dev, blockno) (((dev) * 31 + (blockno)) % NBUCKET)
+
+struct bucket {
+  struct spinlock lock;
+  struct buf *head;
+};
+
+struct {
+  struct bucket bucket[NBUCKET];
+  struct spinlock evictlock;
+  struct buf buf[NBUF];
+  uint stamp[NBUF];  // When buf[i] was last released, for LRU
+  uint clock;        // Next stamp
+} bcache;
+
+void
+binit(void)
+{
+  struct buf *b;
+  int i;
+
+  for(i = 0; i < NBUCKET; i++)
+    initlock(&bcache.bucket[i].lock, "bcache.bucket");
+  initlock(&bcache.evictlock, "bcache");
+
+  // Every buffer starts out as (0, 0), which hashes to bucket 0.
+  for(b = bcache.buf; b < bcache.buf+NBUF; b++){
+    initsleeplock(&b->lock, "buffer");
+    b->next = bcache.bucket[0].head;
+    bcache.bucket[0].head = b;
+  }
+}
+
+// Find the buffer for (dev, blockno) in bk and take a reference.
+// bk's lock must be held.
+static struct buf*
+lookup(struct bucket *bk, uint dev, uint blockno)
+{
+  struct buf *b;
+
+  for(b = bk->head; b; b = b->next){
+    if(b->dev == dev && b->blockno == blockno){
+      b->refcnt++;
+      return b;
+    }
+  }
+  return 0;
+}
+
+// The unused, clean buffer released longest ago.  Returns with
+// the lock of its bucket held, or 0 if every buffer is in use.
+// evictlock must be held.
+static struct buf*
+victim(void)
+{
+  struct buf *b, *best;
+  int i, held, found;
+
+  best = 0;
+  held = -1;
+  for(i = 0; i < NBUCKET; i++){
+    acquire(&bcache.bucket[i].lock);
+    found = 0;
+    for(b = bcache.bucket[i].head; b; b = b->next){
+      if(b->refcnt == 0 && (b->flags & B_DIRTY) == 0 &&
+         (best == 0 || (int)(bcache.stamp[b - bcache.buf] -
+                             bcache.stamp[best - bcache.buf]) < 0)){
+        best = b;
+        found = 1;
+      }
+    }
+    if(found){
+      if(held >= 0)
+        release(&bcache.bucket[held].lock);
+      held = i;
+    } else
+      release(&bcache.bucket[i].lock);
+  }
+  return best;
+}
+
+// Look through buffer cache for block on device dev.
+// If not found, allocate a buffer.
+// In either case, return locked buffer.
+static struct buf*
+bget(uint dev, uint blockno)
+{
+  struct bucket *bk, *old;
+  struct buf *b, **pp;
+
+  bk = &bcache.bucket[HASH(dev, blockno)];
+  acquire(&bk->lock);
+  b = lookup(bk, dev, blockno);
+  release(&bk->lock);
+  if(b){
+    acquiresleep(&b->lock);
+    return b;
+  }
+
+  // Not cached.  Another miss may have brought the block in
+  // before we got evictlock, so look again.
+  acquire(&bcache.evictlock);
+  acquire(&bk->lock);
+  b = lookup(bk, dev, blockno);
+  release(&bk->lock);
+  if(b){
+    release(&bcache.evictlock);
+    acquiresleep(&b->lock);
+    return b;
+  }
+
+  // Recycle the least recently used unused buffer.
+  // Even if refcnt==0, B_DIRTY indicates a buffer is in use
+  // because log.c has modified it but not yet committed it.
+  if((b = victim()) == 0)
+    panic("bget: no buffers");
+  old = &bcache.bucket[HASH(b->dev, b->blockno)];
+  for(pp = &old->head; *pp != b; pp = &(*pp)->next)
+    ;
+  *pp = b->next;
+  b->dev = dev;
+  b->blockno = blockno;
+  b->flags = 0;
+  b->refcnt = 1;
+  release(&old->lock);
+
+  acquire(&bk->lock);
+  b->next = bk->head;
+  bk->head = b;
+  release(&bk->lock);
+  release(&bcache.evictlock);
+  acquiresleep(&b->lock);
+  return b;
+}
+
+// Return a locked buf with the contents of the indicated block.
+struct buf*
+bread(uint dev, uint blockno)
+{
+  struct buf *b;
+
+  b = bget(dev, blockno);
+  if((b->flags & B_VALID) == 0) {
+    iderw(b);
+  }
+  return b;
+}
+
+// Write b's contents to disk.  Must be locked.
+void
+bwrite(struct buf *b)
+{
+  if(!holdingsleep(&b->lock))
+    panic("bwrite");
+  b->flags |= B_DIRTY;
+  iderw(b);
+}
+
+// Release a locked buffer and stamp it for LRU eviction.
+void
+brelse(struct buf *b)
+{
+  struct bucket *bk;
+
+  if(!holdingsleep(&b->lock))
+    panic("brelse");
+
+  releasesleep(&b->lock);
+
+  // b cannot be recycled while we hold a reference, so its
+  // bucket is stable.
+  bk = &bcache.bucket[HASH(b->dev, b->blockno)];
+  acquire(&bk->lock);
+  b->refcnt--;
+  if(b->refcnt == 0)
+    bcache.stamp[b - bcache.buf] = __sync_fetch_and_add(&bcache.clock, 1);
+  release(&bk->lock);
+}
@@ -0,0 +1,103 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Pointer-chasing benchmark over a large sbrk() heap.
+// Every hop lands on a different page, so the run time is dominated
+// by TLB misses; sleeping between rounds forces a context switch
+// (and the TLB flush in switchuvm()) so the heap has to be re-walked.
+// The heap is chased twice: grown by one sbrk() from a 4 MB boundary,
+// which allocuvm() maps with 4 MB pages, and grown a page at a time,
+// which gets 4096-byte pages.
+//
+// Usage: chasebench [megabytes] [rounds]
+
+#define MB (1024*1024)
+#define PAGE 4096
+#define BIGPAGE (4*MB)
+
+static uint seed = 1;
+
+static uint
+rand(void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+// Link the pages of heap into one random cycle (Fisher-Yates), with
+// one pointer at the start of each page, and chase it.
+// Returns the ticks spent chasing.
+static int
+chase(uint *heap, int npages, int rounds)
+{
+  int i, j, r, t0, t1;
+  uint *order, *p;
+
+  order = malloc(npages * sizeof(uint));
+  for(i = 0; i < npages; i++)
+    order[i] = i;
+  for(i = npages - 1; i > 0; i--){
+    j = (rand() << 15 | rand()) % (i + 1);
+    r = order[i];
+    order[i] = order[j];
+    order[j] = r;
+  }
+  for(i = 0; i < npages; i++){
+    p = heap + order[i] * (PAGE / sizeof(uint));
+    *p = (uint)(heap + order[(i + 1) % npages] * (PAGE / sizeof(uint)));
+  }
+  free(order);
+
+  t0 = uptime();
+  p = heap;
+  for(r = 0; r < rounds; r++){
+    for(i = 0; i < npages; i++)
+      p = (uint*)*p;
+    sleep(1);  // force a switch away and back
+  }
+  t1 = uptime();
+  if(p != heap)
+    printf(2, "chasebench: chain broken\n");
+
+  // Subtract the ticks spent sleeping between rounds.
+  return t1 - t0 - rounds;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int mb = 16, rounds = 8;
+  int npages, i, big, small;
+  char *base;
+
+  if(argc > 1)
+    mb = atoi(argv[1]);
+  if(argc > 2)
+    rounds = atoi(argv[2]);
+  npages = mb * MB / PAGE;
+
+  // The malloc() in chase() grows the heap too; do it first so the
+  // 4 MB-aligned region stays whole.
+  free(malloc(npages * sizeof(uint)));
+  base = sbrk(0);
+  sbrk(BIGPAGE - (uint)base % BIGPAGE);
+  base = sbrk(mb * MB);
+  if(base == (char*)-1){
+    printf(2, "chasebench: sbrk %d MB failed\n", mb);
+    exit();
+  }
+  big = chase((uint*)base, npages, rounds);
+
+  base = sbrk(0);
+  for(i = 0; i < npages; i++)
+    if(sbrk(PAGE) == (char*)-1){
+      printf(2, "chasebench: sbrk %d MB failed\n", mb);
+      exit();
+    }
+  small = chase((uint*)base, npages, rounds);
+
+  printf(1, "chasebench mb=%d pages=%d rounds=%d hops=%d ticks4m=%d ticks4k=%d\n",
+         mb, npages, rounds, npages * rounds, big, small);
+  exit();
+}
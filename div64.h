@@ -0,0 +1,19 @@
+// 64-bit division, shared by the kernel (tsc.c) and the benchmarks.
+
+// Divide a 64-bit value by a 32-bit one with two divl instructions;
+// the kernel and user programs are not linked against libgcc, which
+// would provide __udivdi3 for a plain 64-bit '/'.
+static inline unsigned long long
+div64(unsigned long long n, uint d, uint *rem)
+{
+  uint hi, lo, qhi, qlo, r;
+
+  hi = n >> 32;
+  lo = n;
+  qhi = hi / d;
+  r = hi % d;
+  asm("divl %4" : "=a" (qlo), "=d" (r) : "a" (lo), "d" (r), "rm" (d));
+  if(rem)
+    *rem = r;
+  return (unsigned long long)qhi << 32 | qlo;
+}
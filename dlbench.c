@@ -0,0 +1,136 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+// Periodic tasks under load.  Three tasks each run a job of work
+// every period while CPU hogs run at nice 1; a job is late if it
+// finishes after the end of its period.  The test runs once with
+// the tasks in the normal class and once with deadline()
+// reservations, and prints one line per task:
+//   dlbench edf=E task=I runtime=R period=P jobs=J late=L misses=M
+// where misses is the kernel's per-process deadline miss counter.
+//
+// Usage: dlbench [jobs]
+
+#define NTASK 3
+#define NHOG 3
+
+static int runtime[NTASK] = { 2, 3, 4 };   // ticks reserved per period
+static int period[NTASK] = { 10, 20, 40 };
+
+static struct pstat ps[NPROC];
+
+static uint loopspertick;
+
+static void
+spin(uint n)
+{
+  volatile uint i;
+
+  for(i = 0; i < n; i++)
+    ;
+}
+
+// Count spin() loops per tick with the machine otherwise idle.
+static void
+calibrate(void)
+{
+  int t;
+  uint n;
+
+  t = uptime() + 1;
+  while(uptime() < t)
+    ;
+  for(n = 0; uptime() < t + 10; n += 1000)
+    spin(1000);
+  loopspertick = n / 10;
+}
+
+static uint
+mymisses(void)
+{
+  int i, n, pid;
+
+  pid = getpid();
+  n = procsnap(ps, NPROC);
+  for(i = 0; i < n; i++)
+    if(ps[i].pid == pid)
+      return ps[i].dlmiss;
+  return 0;
+}
+
+// Run jobs jobs of task i starting at tick start; report on fd.
+static void
+task(int i, int edf, int jobs, int start, int fd)
+{
+  int j, release, late, rec[3];
+
+  if(edf && deadline(runtime[i], period[i]) < 0)
+    printf(2, "dlbench: deadline %d %d refused\n", runtime[i], period[i]);
+  late = 0;
+  for(j = 0; j < jobs; j++){
+    release = start + j * period[i];
+    if(uptime() < release)
+      sleep(release - uptime());
+    spin(loopspertick * (runtime[i] - 1));  // stay inside the budget
+    if(uptime() > release + period[i])
+      late++;
+  }
+  rec[0] = i;
+  rec[1] = late;
+  rec[2] = mymisses();
+  write(fd, rec, sizeof(rec));  // one write: tasks share the pipe
+  exit();
+}
+
+static void
+run(int edf, int jobs)
+{
+  int fd[2], hog[NHOG], i, start, rec[3];
+
+  for(i = 0; i < NHOG; i++){
+    if((hog[i] = fork()) == 0){
+      nice(getpid(), 1);
+      for(;;)
+        ;
+    }
+  }
+  pipe(fd);
+  start = uptime() + 5;
+  for(i = 0; i < NTASK; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      task(i, edf, jobs, start, fd[1]);
+    }
+  }
+  close(fd[1]);
+  for(i = 0; i < NTASK; i++){
+    if(read(fd[0], rec, sizeof(rec)) != sizeof(rec) ||
+       rec[0] < 0 || rec[0] >= NTASK)
+      break;
+    printf(1, "dlbench edf=%d task=%d runtime=%d period=%d jobs=%d late=%d misses=%d\n",
+           edf, rec[0], runtime[rec[0]], period[rec[0]], jobs, rec[1], rec[2]);
+  }
+  close(fd[0]);
+  for(i = 0; i < NTASK; i++)
+    wait();
+  for(i = 0; i < NHOG; i++){
+    kill(hog[i]);
+    wait();
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int jobs = 20;
+
+  if(argc > 1)
+    jobs = atoi(argv[1]);
+  calibrate();
+  run(0, jobs);
+  run(1, jobs);
+  exit();
+}
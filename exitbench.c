@@ -0,0 +1,89 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Scheduling latency while large processes exit.
+// A churn child repeatedly forks a process that grows by mb
+// megabytes, touches every page and exits, while the parent times
+// one-byte pipe round trips with an echo child.  Teardown of a big
+// address space under ptable.lock shows up as a long tail in the
+// round trips.  Prints
+//   exitbench mb=M n=N p50=.. p90=.. p99=.. max=.. unit=ns
+//
+// Usage: exitbench [mb [n]]
+
+#define NSAMPLE 1000
+#define PAGE 4096
+
+static int samples[NSAMPLE];
+
+// Fork big processes that exit at once, until killed.
+static void
+churn(int mb)
+{
+  char *p, *end;
+
+  for(;;){
+    if(fork() == 0){
+      if((p = sbrk(mb * 1024 * 1024)) == (char*)-1)
+        exit();
+      for(end = p + mb * 1024 * 1024; p < end; p += PAGE)
+        *p = 1;
+      exit();
+    }
+    wait();
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int mb = 16, n = 500;
+  int ping[2], pong[2], i, pid;
+  unsigned long long t0;
+  char c;
+
+  if(argc > 1)
+    mb = atoi(argv[1]);
+  if(argc > 2)
+    n = atoi(argv[2]);
+  if(n > NSAMPLE)
+    n = NSAMPLE;
+
+  pipe(ping);
+  pipe(pong);
+  if(fork() == 0){
+    close(ping[1]);
+    close(pong[0]);
+    while(read(ping[0], &c, 1) == 1)
+      write(pong[1], &c, 1);
+    exit();
+  }
+  close(ping[0]);
+  close(pong[1]);
+
+  if((pid = fork()) == 0){
+    close(ping[1]);
+    close(pong[0]);
+    churn(mb);
+  }
+
+  sleep(10);  // let the churn get going
+  for(i = 0; i < n; i++){
+    t0 = nsnow();
+    write(ping[1], "x", 1);
+    read(pong[0], &c, 1);
+    samples[i] = nsnow() - t0;
+  }
+  close(ping[1]);
+  close(pong[0]);
+  kill(pid);
+  wait();
+  wait();
+
+  sort(samples, n);
+  printf(1, "exitbench mb=%d n=%d p50=%d p90=%d p99=%d max=%d unit=ns\n",
+         mb, n, samples[n*50/100], samples[n*90/100], samples[n*99/100],
+         samples[n-1]);
+  exit();
+}
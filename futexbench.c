@@ -0,0 +1,135 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "div64.h"
+#include "ulock.h"
+
+// Futex-based mutex and condition variable (ulock.c).
+//   futexbench uncontended ...  ns per lock/unlock pair, one thread
+//   futexbench mutex ...        nthread threads each add 1 to a
+//                               counter iters times under the mutex;
+//                               ok=1 if no update was lost
+//   futexbench spin ...         the same under a test-and-set lock
+//                               that yields while it spins
+//   futexbench pingpong ...     ns per round trip between two threads
+//                               handing a turn over a condition variable
+//
+// Usage: futexbench [nthread [iters]]
+
+static struct mutex m;
+static struct cond cv;
+static volatile int spinlock, counter, turn, iters, rounds;
+
+static void
+adder(void *arg)
+{
+  int i;
+
+  for(i = 0; i < iters; i++){
+    mutex_lock(&m);
+    counter++;
+    mutex_unlock(&m);
+  }
+  exit();
+}
+
+static void
+spinadder(void *arg)
+{
+  int i;
+
+  for(i = 0; i < iters; i++){
+    while(__sync_lock_test_and_set(&spinlock, 1) != 0)
+      yield();
+    counter++;
+    __sync_lock_release(&spinlock);
+  }
+  exit();
+}
+
+// Wait for turn me, then hand the turn to the other thread.
+static void
+pinger(void *arg)
+{
+  int i, me = (int)arg;
+
+  for(i = 0; i < rounds; i++){
+    mutex_lock(&m);
+    while(turn != me)
+      cond_wait(&cv, &m);
+    turn = !me;
+    cond_signal(&cv);
+    mutex_unlock(&m);
+  }
+  exit();
+}
+
+static void
+uncontended(int n)
+{
+  int i;
+  unsigned long long t0, t;
+
+  mutex_init(&m);
+  t0 = nsnow();
+  for(i = 0; i < n; i++){
+    mutex_lock(&m);
+    mutex_unlock(&m);
+  }
+  t = nsnow() - t0;
+  printf(1, "futexbench uncontended n=%d per_pair=%d unit=ns\n", n, (uint)div64(t, n, 0));
+}
+
+static void
+contended(char *name, void (*fn)(void*), int nthread)
+{
+  int i;
+  unsigned long long t0, t;
+
+  mutex_init(&m);
+  spinlock = 0;
+  counter = 0;
+  t0 = nsnow();
+  for(i = 0; i < nthread; i++)
+    thread_create(fn, 0);
+  for(i = 0; i < nthread; i++)
+    thread_join();
+  t = nsnow() - t0;
+  printf(1, "futexbench %s threads=%d iters=%d total_us=%d ok=%d\n",
+         name, nthread, iters, (uint)div64(t, 1000, 0), counter == nthread * iters);
+}
+
+static void
+pingpong(int n)
+{
+  unsigned long long t0, t;
+
+  mutex_init(&m);
+  cond_init(&cv);
+  turn = 0;
+  rounds = n;
+  t0 = nsnow();
+  thread_create(pinger, (void*)0);
+  thread_create(pinger, (void*)1);
+  thread_join();
+  thread_join();
+  t = nsnow() - t0;
+  printf(1, "futexbench pingpong n=%d per_round=%d unit=ns\n", n, (uint)div64(t, n, 0));
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nthread = 4;
+
+  iters = 10000;
+  if(argc > 1)
+    nthread = atoi(argv[1]);
+  if(argc > 2)
+    iters = atoi(argv[2]);
+  uncontended(100000);
+  contended("mutex", adder, nthread);
+  contended("spin", spinadder, nthread);
+  pingpong(1000);
+  exit();
+}
@@ -0,0 +1,85 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Group share benchmark.  Two jobs each create a scheduling group
+// and fork CPU-bound spinners, job a with na of them and job b with
+// nb.  With group shares the CPU splits by sharesa:sharesb whatever
+// the fan-out; without, it would split na:nb.
+//
+// Usage: grpbench [na nb [sharesa sharesb [ticks]]]
+
+// Run one job: create the group, fork n spinners until tick end,
+// report the total work done by the job on fd.
+static void
+job(int n, int shares, int start, int end, int fd)
+{
+  int i, rec, total;
+  int res[2];
+  volatile int w;
+
+  if(grpcreate(shares) < 0){
+    printf(2, "grpbench: grpcreate failed\n");
+    total = 0;
+    write(fd, &total, sizeof(total));
+    exit();
+  }
+  pipe(res);
+  for(i = 0; i < n; i++){
+    if(fork() == 0){
+      close(res[0]);
+      while(uptime() < start)
+        ;
+      for(w = 0; uptime() < end; w++)
+        ;
+      rec = w;
+      write(res[1], &rec, sizeof(rec));
+      exit();
+    }
+  }
+  close(res[1]);
+  total = 0;
+  for(i = 0; i < n; i++){
+    if(read(res[0], &rec, sizeof(rec)) == sizeof(rec))
+      total += rec;
+    wait();
+  }
+  close(res[0]);
+  write(fd, &total, sizeof(total));
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int na = 1, nb = 4, sa = 100, sb = 100, ticks = 200;
+  int fa[2], fb[2], wa, wb, start;
+
+  if(argc > 2){
+    na = atoi(argv[1]);
+    nb = atoi(argv[2]);
+  }
+  if(argc > 4){
+    sa = atoi(argv[3]);
+    sb = atoi(argv[4]);
+  }
+  if(argc > 5)
+    ticks = atoi(argv[5]);
+
+  pipe(fa);
+  pipe(fb);
+  start = uptime() + 5;
+  if(fork() == 0)
+    job(na, sa, start, start + ticks, fa[1]);
+  if(fork() == 0)
+    job(nb, sb, start, start + ticks, fb[1]);
+  if(read(fa[0], &wa, sizeof(wa)) != sizeof(wa))
+    wa = 0;
+  if(read(fb[0], &wb, sizeof(wb)) != sizeof(wb))
+    wb = 0;
+  wait();
+  wait();
+  printf(1, "grpbench na=%d nb=%d sharesa=%d sharesb=%d ticks=%d worka=%d workb=%d\n",
+         na, nb, sa, sb, ticks, wa, wb);
+  exit();
+}
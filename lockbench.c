@@ -0,0 +1,72 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Yield storm: nproc children call yield() as fast as they can for
+// a fixed number of ticks.  Every yield takes ptable.lock twice
+// (yield() and scheduler()), so throughput measures the cost of the
+// lock under contention and the spread between the busiest and the
+// idlest child measures fairness.  Run it with CPUS=1..8, e.g. via
+//   ./benchsmp.sh "lockbench 8 200" 1 2 4 8
+//
+// Usage: lockbench [nproc] [ticks]
+
+#define MAXPROC 32
+
+int
+main(int argc, char *argv[])
+{
+  int nproc = 8, ticks = 200;
+  int fd[2], i, n, start, total, min, max;
+
+  if(argc > 1)
+    nproc = atoi(argv[1]);
+  if(argc > 2)
+    ticks = atoi(argv[2]);
+  if(nproc < 1 || nproc > MAXPROC)
+    nproc = 8;
+
+  if(pipe(fd) < 0){
+    printf(2, "lockbench: pipe failed\n");
+    exit();
+  }
+
+  // Everyone starts and stops on the same tick.
+  start = uptime() + 2;
+  for(i = 0; i < nproc; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      while(uptime() < start)
+        ;
+      n = 0;
+      while(uptime() < start + ticks){
+        yield();
+        n++;
+      }
+      write(fd[1], &n, sizeof(n));
+      exit();
+    }
+  }
+  close(fd[1]);
+
+  total = 0;
+  min = -1;
+  max = 0;
+  for(i = 0; i < nproc; i++){
+    if(read(fd[0], &n, sizeof(n)) != sizeof(n))
+      break;
+    total += n;
+    if(min < 0 || n < min)
+      min = n;
+    if(n > max)
+      max = n;
+  }
+  for(i = 0; i < nproc; i++)
+    wait();
+
+  // fair is min/max in percent: 100 means every child got equal service.
+  printf(1, "lockbench nproc=%d ticks=%d yields=%d per_tick=%d min=%d max=%d fair=%d\n",
+         nproc, ticks, total, total / ticks, min, max,
+         max ? min * 100 / max : 0);
+  exit();
+}
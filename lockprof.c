@@ -0,0 +1,151 @@
+// Lock contention statistics.
+//
+// Locks of interest are registered once at boot.  Call sites that
+// use lockstat_acquire/lockstat_release instead of acquire/release
+// count acquisitions, detect contention (the lock was already held
+// when we arrived), time the spin and the hold with rdtsc, and keep
+// the callers of contended acquisitions.  Unregistered locks pass
+// straight through to acquire/release.  Other lock types (see
+// ticketlock.c) report through lockstat_acquired/lockstat_releasing.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "spinlock.h"
+#include "lockstat.h"
+#include "tsc.h"
+
+#if LOCKSTAT
+
+static struct {
+  void *lk;
+  char *name;
+  unsigned long long t0;   // rdtsc at the current acquisition
+  struct lockstat st;
+} stats[NLOCKSTAT];
+static int nstats;
+
+// Start collecting statistics for lk, a spinlock or ticketlock.
+// Call during boot, before other CPUs use the lock.
+void
+lockstat_register(void *lk, char *name)
+{
+  if(nstats == NLOCKSTAT)
+    panic("lockstat_register");
+  stats[nstats].lk = lk;
+  stats[nstats].name = name;
+  nstats++;
+}
+
+static int
+lookup(void *lk)
+{
+  int i;
+
+  for(i = 0; i < nstats; i++)
+    if(stats[i].lk == lk)
+      return i;
+  return -1;
+}
+
+// Credit a contended acquisition to caller pc.  Keeps the
+// LOCKSTAT_NPC most frequent callers: an unseen caller replaces
+// the least frequent one.  The lock is held, so no races.
+static void
+addcaller(struct lockstat *st, uint pc)
+{
+  int i, min;
+
+  min = 0;
+  for(i = 0; i < LOCKSTAT_NPC; i++){
+    if(st->pc[i] == pc){
+      st->pccount[i]++;
+      return;
+    }
+    if(st->pccount[i] < st->pccount[min])
+      min = i;
+  }
+  st->pc[min] = pc;
+  st->pccount[min]++;
+}
+
+// Record an acquisition of lk that spun for spin cycles.
+// Called with lk held.
+void
+lockstat_acquired(void *lk, int contended, unsigned long long spin, uint pc)
+{
+  struct lockstat *st;
+  int i;
+
+  if((i = lookup(lk)) < 0)
+    return;
+  st = &stats[i].st;
+  st->acquires++;
+  if(contended){
+    st->contended++;
+    st->spin += spin;
+    addcaller(st, pc);
+  }
+  stats[i].t0 = rdtsc();
+}
+
+// Record the end of a hold.  Called with lk still held.
+void
+lockstat_releasing(void *lk)
+{
+  unsigned long long hold;
+  int i;
+
+  if((i = lookup(lk)) < 0)
+    return;
+  hold = rdtsc() - stats[i].t0;
+  if(hold > stats[i].st.maxhold)
+    stats[i].st.maxhold = hold;
+}
+
+void
+lockstat_acquire(struct spinlock *lk)
+{
+  unsigned long long t0;
+  uint pcs[10];
+  int busy;
+
+  if(lookup(lk) < 0){
+    acquire(lk);
+    return;
+  }
+  busy = lk->locked;
+  t0 = rdtsc();
+  acquire(lk);
+  pcs[0] = 0;
+  if(busy)
+    getcallerpcs(&lk, pcs);
+  lockstat_acquired(lk, busy, rdtsc() - t0, pcs[0]);
+}
+
+void
+lockstat_release(struct spinlock *lk)
+{
+  lockstat_releasing(lk);
+  release(lk);
+}
+
+// Copy up to n lock statistics to st, then clear them if reset.
+// Returns the number copied.  Counters are read without locking,
+// so a snapshot can be off by the acquisitions in flight.
+int
+lockstat_read(struct lockstat *st, int n, int reset)
+{
+  int i, count;
+
+  for(count = 0; count < nstats && count < n; count++){
+    st[count] = stats[count].st;
+    safestrcpy(st[count].name, stats[count].name, sizeof(st[count].name));
+  }
+  if(reset)
+    for(i = 0; i < nstats; i++)
+      memset(&stats[i].st, 0, sizeof(stats[i].st));
+  return count;
+}
+
+#endif
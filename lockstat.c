@@ -0,0 +1,35 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "lockstat.h"
+
+// Print spinlock contention statistics collected by the kernel.
+// Cycle counts are shown in units of 1024 cycles (kcyc).
+//
+// Usage: lockstat [-r]    -r resets the counters after printing
+
+static struct lockstat st[NLOCKSTAT];
+
+int
+main(int argc, char *argv[])
+{
+  int i, j, n, reset;
+
+  reset = argc > 1 && strcmp(argv[1], "-r") == 0;
+  if((n = lockstat(st, NLOCKSTAT, reset)) < 0){
+    printf(2, "lockstat: not enabled (set LOCKSTAT to 1 in lockstat.h)\n");
+    exit();
+  }
+
+  printf(1, "name acquires contended spin_kcyc maxhold_kcyc callers\n");
+  for(i = 0; i < n; i++){
+    printf(1, "%s %d %d %d %d", st[i].name, st[i].acquires,
+           st[i].contended, (uint)(st[i].spin >> 10),
+           (uint)(st[i].maxhold >> 10));
+    for(j = 0; j < LOCKSTAT_NPC; j++)
+      if(st[i].pccount[j])
+        printf(1, " %x:%d", st[i].pc[j], st[i].pccount[j]);
+    printf(1, "\n");
+  }
+  exit();
+}
@@ -0,0 +1,34 @@
+// Lock contention statistics.
+// Set LOCKSTAT to 1 to collect statistics for registered locks;
+// with 0, lockstat_acquire/lockstat_release are plain acquire/release.
+#define LOCKSTAT 0
+
+#define NLOCKSTAT     16  // max registered locks
+#define LOCKSTAT_NPC   4  // callers tracked per lock
+
+// Per-lock statistics, as returned by the lockstat() system call.
+struct lockstat {
+  char name[16];
+  uint acquires;                // Total acquisitions
+  uint contended;               // Acquisitions that found the lock held
+  unsigned long long spin;      // Cycles spent spinning when contended
+  unsigned long long maxhold;   // Longest hold, in cycles
+  uint pc[LOCKSTAT_NPC];        // Callers with the most contended acquires
+  uint pccount[LOCKSTAT_NPC];   // Contended acquires per caller
+};
+
+// lockprof.c
+struct spinlock;
+#if LOCKSTAT
+void lockstat_register(void*, char*);
+void lockstat_acquire(struct spinlock*);
+void lockstat_release(struct spinlock*);
+void lockstat_acquired(void*, int, unsigned long long, uint);
+void lockstat_releasing(void*);
+int lockstat_read(struct lockstat*, int, int);
+#else
+#define lockstat_register(lk, name)
+#define lockstat_acquire(lk) acquire(lk)
+#define lockstat_release(lk) release(lk)
+#define lockstat_read(st, n, reset) (-1)
+#endif
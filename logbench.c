@@ -0,0 +1,92 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "logstat.h"
+
+// File-system log commits under concurrent writers.
+//   logbench create ...  nproc processes each create, write and
+//                        unlink a small file iters times
+//   logbench exit ...    nproc processes each fork iters children
+//                        that exit at once (exit() runs iput(cwd) in
+//                        its own log operation)
+// For each it prints the log operations, the commits that wrote
+// anything, the blocks logged per commit and disk writes per 100
+// operations, from logstat().  Group commit (GROUP_DELAY in log.c)
+// lets one commit carry the blocks of many concurrent operations.
+//
+// Usage: logbench [nproc [iters]]
+
+static struct logstat st;
+
+static void
+creator(int id, int iters)
+{
+  char path[16], buf[64];
+  int i, fd;
+
+  strcpy(path, "logbench.0");
+  path[9] = '0' + id;
+  memset(buf, 'x', sizeof(buf));
+  for(i = 0; i < iters; i++){
+    if((fd = open(path, O_CREATE | O_RDWR)) < 0){
+      printf(2, "logbench: cannot create %s\n", path);
+      exit();
+    }
+    write(fd, buf, sizeof(buf));
+    close(fd);
+    unlink(path);
+  }
+}
+
+static void
+exiter(int id, int iters)
+{
+  int i;
+
+  for(i = 0; i < iters; i++){
+    if(fork() == 0)
+      exit();
+    wait();
+  }
+}
+
+static void
+run(char *mode, void (*fn)(int, int), int nproc, int iters)
+{
+  int i, t0;
+
+  logstat(&st, 1);
+  t0 = uptime();
+  for(i = 0; i < nproc; i++){
+    if(fork() == 0){
+      fn(i, iters);
+      exit();
+    }
+  }
+  for(i = 0; i < nproc; i++)
+    wait();
+  logstat(&st, 0);
+  printf(1, "logbench %s procs=%d ops=%d commits=%d blocks_per_commit=%d "
+         "writes_per_100ops=%d wait_kcycles=%d ticks=%d\n",
+         mode, nproc, st.ops, st.commits,
+         st.commits ? st.blocks / st.commits : 0,
+         st.ops ? st.diskwrites * 100 / st.ops : 0,
+         (uint)(st.wait >> 10), uptime() - t0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nproc = 4, iters = 50;
+
+  if(argc > 1)
+    nproc = atoi(argv[1]);
+  if(argc > 2)
+    iters = atoi(argv[2]);
+  if(nproc < 1 || nproc > 10)
+    nproc = 4;
+  run("create", creator, nproc, iters);
+  run("exit", exiter, nproc, iters);
+  exit();
+}
@@ -0,0 +1,11 @@
+// File-system log statistics, as returned by the logstat() system call.
+struct logstat {
+  uint ops;                 // Operations (begin_op/end_op pairs)
+  uint commits;             // Commits that wrote anything
+  uint blocks;              // Blocks logged, over all commits
+  uint diskwrites;          // Disk writes made by commits
+  unsigned long long wait;  // Cycles spent waiting in begin_op and end_op
+};
+
+// log.c
+int logstat_read(struct logstat*, int);
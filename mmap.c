@@ -0,0 +1,277 @@
+// Memory-mapped files.
+//
+// mmap() only records the mapping in one of the process's vma
+// slots.  Pages are read from the file when first touched: trap()
+// hands page faults to vmafault(), which maps a zeroed page and
+// fills it from the file, read-only unless mapped PROT_WRITE.
+// Mappings are placed downwards from MMAPTOP, and growproc() will
+// not grow the heap into them.  Every mapping is private: the pages
+// belong to the process, so freevm() frees them like any other, and
+// fork() gives the child copies of those already faulted in.  exec()
+// drops the mappings with vmaexit() when it replaces the page table.
+//
+// Threads fault pages in through the vma slots of the process that
+// created them.  Fills sleep on disk I/O, so that process's vmabusy
+// flag, taken with lockvma(), serializes them; growproc() takes it
+// too, so that nothing else changes the shared page table meanwhile.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "mmap.h"
+#include "upage.h"
+
+#define MMAPTOP UPROC  // Below the pages getpid() and uptime() read
+#define FEC_PR  0x1    // Page fault error code: page present
+
+// proc.c
+int vmshared(struct proc*);
+
+// The process whose vma slots describe p's address space: threads
+// use those of the process that created them.
+static struct proc*
+owner(struct proc *p)
+{
+  while(p->thread)
+    p = p->parent;
+  return p;
+}
+
+static struct spinlock vmalock;  // Guards every process's vmabusy
+
+void
+vmainit(void)
+{
+  initlock(&vmalock, "vma");
+}
+
+// Take the vma slots, and with them the page table, of the process
+// p's mappings belong to.
+void
+lockvma(struct proc *p)
+{
+  p = owner(p);
+  acquire(&vmalock);
+  while(p->vmabusy)
+    sleep(&p->vmabusy, &vmalock);
+  p->vmabusy = 1;
+  release(&vmalock);
+}
+
+void
+unlockvma(struct proc *p)
+{
+  p = owner(p);
+  acquire(&vmalock);
+  p->vmabusy = 0;
+  wakeup(&p->vmabusy);
+  release(&vmalock);
+}
+
+// Make the user page at a, which must be mapped, read-only.
+// It was not present before, so no TLB holds it writable.
+static void
+readonly(pde_t *pgdir, uint a)
+{
+  pte_t *pgtab;
+
+  pgtab = (pte_t*)P2V(PTE_ADDR(pgdir[PDX(a)]));
+  pgtab[PTX(a)] &= ~PTE_W;
+}
+
+static void
+drop(struct vma *v)
+{
+  struct file *f;
+
+  f = v->f;
+  v->f = 0;
+  fileclose(f);
+}
+
+// Lowest address used by p's mappings; the heap must stay below it.
+uint
+vmabase(struct proc *p)
+{
+  struct vma *v;
+  uint base;
+
+  p = owner(p);
+  base = MMAPTOP;
+  for(v = p->vma; v < &p->vma[NVMA]; v++)
+    if(v->f && v->addr < base)
+      base = v->addr;
+  return base;
+}
+
+// Map len bytes of f starting at offset off into the current
+// process.  Returns the address, or 0 on failure.
+uint
+vmamap(struct file *f, uint off, uint len, int prot)
+{
+  struct vma *v, *free;
+  uint base;
+
+  if(proc->thread || f->type != FD_INODE || !f->readable ||
+     off % PGSIZE != 0 || len == 0 || len > VMAPAGES*PGSIZE)
+    return 0;
+  if((prot & PROT_WRITE) && !f->writable)
+    return 0;
+  len = PGROUNDUP(len);
+
+  lockvma(proc);
+  free = 0;
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++)
+    if(v->f == 0 && free == 0)
+      free = v;
+  base = vmabase(proc);
+  if(free == 0 || base - len < PGROUNDUP(proc->sz)){
+    unlockvma(proc);
+    return 0;
+  }
+
+  free->addr = base - len;
+  free->len = len;
+  free->off = off;
+  free->prot = prot;
+  memset(free->resident, 0, sizeof(free->resident));
+  free->f = filedup(f);
+  unlockvma(proc);
+  return free->addr;
+}
+
+// Remove the mapping at addr, which must be len bytes long,
+// freeing the pages faulted in.  Like growproc(), it refuses while
+// threads share the address space: other CPUs might still hold the
+// freed pages in their TLB.
+int
+vmaunmap(uint addr, uint len)
+{
+  struct vma *v;
+
+  if(vmshared(proc))
+    return -1;
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++){
+    if(v->f && v->addr == addr && v->len == PGROUNDUP(len)){
+      deallocuvm(proc->pgdir, v->addr + v->len, v->addr);
+      switchuvm(proc);
+      drop(v);
+      return 0;
+    }
+  }
+  return -1;
+}
+
+// Page fault at va, with error code err, in the current process.
+// If va lies in a mapping, read its page from the file and return
+// 0; the faulting instruction can then be restarted.  Otherwise
+// return -1.
+int
+vmafault(uint va, uint err)
+{
+  struct proc *p;
+  struct vma *v;
+  struct inode *ip;
+  uint a, i, off, n;
+
+  if(proc == 0 || (err & FEC_PR))
+    return -1;  // A protection fault
+  p = owner(proc);
+  lockvma(p);
+  for(v = p->vma; v < &p->vma[NVMA]; v++)
+    if(v->f && va >= v->addr && va < v->addr + v->len)
+      break;
+  if(v == &p->vma[NVMA])
+    goto bad;
+
+  a = PGROUNDDOWN(va);
+  i = (a - v->addr) / PGSIZE;
+  if(v->resident[i/8] & (1 << (i%8))){
+    unlockvma(p);
+    return 0;  // Another thread faulted it in meanwhile
+  }
+  if(allocuvm(p->pgdir, a, a + PGSIZE) == 0)
+    goto bad;
+
+  // Past the end of the file the page stays zero.
+  off = v->off + (a - v->addr);
+  ip = v->f->ip;
+  ilock(ip);
+  n = ip->size > off ? ip->size - off : 0;
+  if(n > PGSIZE)
+    n = PGSIZE;
+  if(n > 0 && loaduvm(p->pgdir, (char*)a, ip, off, n) < 0){
+    iunlock(ip);
+    deallocuvm(p->pgdir, a + PGSIZE, a);
+    goto bad;
+  }
+  iunlock(ip);
+  if((v->prot & PROT_WRITE) == 0)
+    readonly(p->pgdir, a);
+  v->resident[i/8] |= 1 << (i%8);
+  unlockvma(p);
+  return 0;
+
+bad:
+  unlockvma(p);
+  return -1;
+}
+
+// Give child np, whose page table fork() has just copied, the
+// current process's mappings and copies of their resident pages.
+// On failure the child's mappings are dropped again.
+int
+vmafork(struct proc *np)
+{
+  struct vma *v, *nv;
+  uint a, i;
+  char *mem;
+
+  lockvma(proc);
+  for(v = proc->vma; v < &proc->vma[NVMA]; v++){
+    nv = &np->vma[v - proc->vma];
+    if(v->f == 0)
+      continue;
+    *nv = *v;
+    nv->f = filedup(v->f);
+    for(i = 0; i < v->len / PGSIZE; i++){
+      if((v->resident[i/8] & (1 << (i%8))) == 0)
+        continue;
+      a = v->addr + i*PGSIZE;
+      if((mem = uva2ka(proc->pgdir, (char*)a)) == 0 ||
+         allocuvm(np->pgdir, a, a + PGSIZE) == 0 ||
+         copyout(np->pgdir, a, mem, PGSIZE) < 0){
+        unlockvma(proc);
+        vmaexit(np);
+        return -1;
+      }
+      if((v->prot & PROT_WRITE) == 0)
+        readonly(np->pgdir, a);
+    }
+  }
+  unlockvma(proc);
+  return 0;
+}
+
+// Drop p's mappings.  The pages themselves go with the page table.
+// Threads have none of their own.
+void
+vmaexit(struct proc *p)
+{
+  struct vma *v;
+
+  if(p->thread)
+    return;
+  lockvma(p);
+  for(v = p->vma; v < &p->vma[NVMA]; v++)
+    if(v->f)
+      drop(v);
+  unlockvma(p);
+}
@@ -0,0 +1,16 @@
+// Memory-mapped files.
+#define PROT_READ   0x1
+#define PROT_WRITE  0x2
+
+// mmap.c
+struct file;
+struct proc;
+uint vmamap(struct file*, uint, uint, int);
+int vmaunmap(uint, uint);
+int vmafault(uint, uint);
+int vmafork(struct proc*);
+void vmaexit(struct proc*);
+uint vmabase(struct proc*);
+void vmainit(void);
+void lockvma(struct proc*);
+void unlockvma(struct proc*);
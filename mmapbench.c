@@ -0,0 +1,134 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "div64.h"
+#include "fcntl.h"
+#include "mmap.h"
+
+// Scanning a file with read() against mmap().
+//   mmapbench read ...  rounds times: open the file, read() it in 4 KB
+//                       chunks and add up its bytes
+//   mmapbench mmap ...  the same through mmap(), so pages fault in
+//                       from the file on first touch
+//   mmapbench fork ...  touch half of a mapping, fork, and let the
+//                       child add up the whole mapping
+// Times are ns per KB; ok=1 if every sum matched the read() one.
+// The file is kb kilobytes, at most 70 (the largest xv6 file).
+//
+// Usage: mmapbench [kb [rounds]]
+
+#define CHUNK 4096
+
+static char buf[CHUNK];
+static char *path = "mmapbench.dat";
+
+static uint
+sum(char *p, int n)
+{
+  uint s;
+  int i;
+
+  s = 0;
+  for(i = 0; i < n; i++)
+    s += (uchar)p[i];
+  return s;
+}
+
+static uint
+readsum(void)
+{
+  int fd, n;
+  uint s;
+
+  fd = open(path, O_RDONLY);
+  s = 0;
+  while((n = read(fd, buf, CHUNK)) > 0)
+    s += sum(buf, n);
+  close(fd);
+  return s;
+}
+
+static uint
+mmapsum(int size)
+{
+  int fd;
+  char *p;
+  uint s;
+
+  fd = open(path, O_RDONLY);
+  if((p = mmap(fd, 0, size, PROT_READ)) == (char*)-1){
+    printf(2, "mmapbench: mmap failed\n");
+    exit();
+  }
+  s = sum(p, size);
+  munmap(p, size);
+  close(fd);
+  return s;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int kb = 64, rounds = 20;
+  int i, fd, size, ok, pfd[2];
+  uint want, got;
+  unsigned long long t0, t;
+  char *p;
+
+  if(argc > 1)
+    kb = atoi(argv[1]);
+  if(argc > 2)
+    rounds = atoi(argv[2]);
+  if(kb < 1 || kb > 70)
+    kb = 64;
+  size = kb * 1024;
+
+  if((fd = open(path, O_CREATE | O_RDWR)) < 0){
+    printf(2, "mmapbench: cannot create %s\n", path);
+    exit();
+  }
+  for(i = 0; i < size; i++){
+    buf[i % CHUNK] = i * 7;
+    if(i % CHUNK == CHUNK - 1 || i == size - 1)
+      write(fd, buf, i % CHUNK + 1);
+  }
+  close(fd);
+
+  want = readsum();
+  ok = 1;
+  t0 = nsnow();
+  for(i = 0; i < rounds; i++)
+    ok = ok && readsum() == want;
+  t = nsnow() - t0;
+  printf(1, "mmapbench read kb=%d rounds=%d per_kb=%d unit=ns ok=%d\n",
+         kb, rounds, (uint)div64(t, rounds * kb, 0), ok);
+
+  ok = 1;
+  t0 = nsnow();
+  for(i = 0; i < rounds; i++)
+    ok = ok && mmapsum(size) == want;
+  t = nsnow() - t0;
+  printf(1, "mmapbench mmap kb=%d rounds=%d per_kb=%d unit=ns ok=%d\n",
+         kb, rounds, (uint)div64(t, rounds * kb, 0), ok);
+
+  fd = open(path, O_RDONLY);
+  p = mmap(fd, 0, size, PROT_READ);
+  close(fd);  // the mapping keeps the file open
+  sum(p, size / 2);
+  pipe(pfd);
+  t0 = nsnow();
+  if(fork() == 0){
+    got = sum(p, size);
+    write(pfd[1], &got, sizeof(got));
+    exit();
+  }
+  got = 0;
+  read(pfd[0], &got, sizeof(got));
+  wait();
+  t = nsnow() - t0;
+  printf(1, "mmapbench fork kb=%d per_kb=%d unit=ns ok=%d\n",
+         kb, (uint)div64(t, kb, 0), got == want);
+  munmap(p, size);
+  unlink(path);
+  exit();
+}
@@ -0,0 +1,111 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "div64.h"
+#include "param.h"
+#include "pstat.h"
+
+// Process groups against per-pid kill() and nice().
+// Forks n sleeping workers into one process group, then
+//   pgbench nice ...  renices them all with one nice() per worker,
+//                     then with a single nicepg()
+//   pgbench kill ...  kills them with one kill() per worker (a fresh
+//                     set), then with a single killpg()
+// Times are ns per worker.  ok=1 if procsnap() saw every worker at
+// the new nice value afterwards.
+//
+// Usage: pgbench [n]
+
+static struct pstat ps[NPROC];
+static int pids[NPROC];
+
+// Fork n workers that sleep until killed, all in the process group
+// of the first.  Returns that group.
+static int
+workers(int n)
+{
+  int i, pgid;
+
+  pgid = 0;
+  for(i = 0; i < n; i++){
+    if((pids[i] = fork()) == 0){
+      for(;;)
+        sleep(1000);
+    }
+    if(pids[i] < 0){
+      printf(2, "pgbench: fork failed\n");
+      exit();
+    }
+    if(pgid == 0)
+      pgid = pids[i];
+    setpgid(pids[i], pgid);
+  }
+  return pgid;
+}
+
+// Do all n members of group pgid have nice value nice?
+static int
+check(int pgid, int nice, int n)
+{
+  int i, m, found;
+
+  m = procsnap(ps, NPROC);
+  found = 0;
+  for(i = 0; i < m; i++){
+    if(ps[i].pgid != pgid || ps[i].state == PS_ZOMBIE)
+      continue;
+    if(ps[i].nice != nice)
+      return 0;
+    found++;
+  }
+  return found == n;
+}
+
+static void
+reap(int n)
+{
+  int i;
+
+  for(i = 0; i < n; i++)
+    wait();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = 32, i, pgid, ok;
+  unsigned long long t0, tpid, tpg;
+
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n < 1 || n > NPROC - 4)
+    n = NPROC - 4;
+
+  pgid = workers(n);
+  t0 = nsnow();
+  for(i = 0; i < n; i++)
+    nice(pids[i], 4);
+  tpid = nsnow() - t0;
+  ok = check(pgid, 4, n);
+  t0 = nsnow();
+  nicepg(pgid, 2);
+  tpg = nsnow() - t0;
+  ok = ok && check(pgid, 2, n);
+  printf(1, "pgbench nice n=%d pid=%d pg=%d unit=ns ok=%d\n",
+         n, (uint)div64(tpid, n, 0), (uint)div64(tpg, n, 0), ok);
+
+  t0 = nsnow();
+  for(i = 0; i < n; i++)
+    kill(pids[i]);
+  tpid = nsnow() - t0;
+  reap(n);
+
+  pgid = workers(n);
+  t0 = nsnow();
+  ok = killpg(pgid) == n;
+  tpg = nsnow() - t0;
+  reap(n);
+  printf(1, "pgbench kill n=%d pid=%d pg=%d unit=ns ok=%d\n",
+         n, (uint)div64(tpid, n, 0), (uint)div64(tpg, n, 0), ok);
+  exit();
+}
@@ -0,0 +1,286 @@
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "proc.h"
+#include "fs.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "file.h"
+
+// Pipes.
+//
+// Bytes go through a ring of PIPEPAGES pages, which pipesize() can
+// grow up to NPIPEPAGE pages (a power of two, so that nread and
+// nwrite may wrap).  The ring is copied in page-sized chunks, and a
+// bigger ring lets the writer and the reader run longer before one
+// has to sleep and wake the other.
+//
+// With PIPEDIRECT, a write of whole, page-aligned pages into an
+// empty pipe that is too big for the ring is not copied into it
+// (smaller writes fit and need not wait): the writer posts its
+// buffer and sleeps, and readers copy straight out of the writer's
+// pages (found with uva2ka) into their own buffers, so each byte is
+// copied once instead of twice.  Other writers wait until the posted
+// write has been consumed.
+
+#define PIPEPAGES  1   // Ring pages in a new pipe
+#define NPIPEPAGE  16  // Most ring pages pipesize() allows
+#define PIPEDIRECT 1   // Hand whole-page writes straight to readers
+
+struct pipe {
+  struct spinlock lock;
+  char *page[NPIPEPAGE];
+  uint size;       // ring capacity in bytes
+  uint nread;     // number of bytes read
+  uint nwrite;    // number of bytes written
+  int readopen;   // read fd is still open
+  int writeopen;  // write fd is still open
+  struct proc *wrproc;  // writer with a posted direct write, or 0
+  pde_t *wrpgdir;       // its address space
+  uint wraddr;          // next byte of the posted buffer
+  uint wrlen;           // bytes of it not yet read
+  int wrerr;            // a reader could not reach the buffer
+};
+
+static void
+freering(struct pipe *p)
+{
+  int i;
+
+  for(i = 0; i < NPIPEPAGE; i++){
+    if(p->page[i])
+      kfree(p->page[i]);
+    p->page[i] = 0;
+  }
+}
+
+int
+pipealloc(struct file **f0, struct file **f1)
+{
+  struct pipe *p;
+  int i;
+
+  p = 0;
+  *f0 = *f1 = 0;
+  if((*f0 = filealloc()) == 0 || (*f1 = filealloc()) == 0)
+    goto bad;
+  if((p = (struct pipe*)kalloc()) == 0)
+    goto bad;
+  memset(p, 0, sizeof(*p));
+  for(i = 0; i < PIPEPAGES; i++)
+    if((p->page[i] = kalloc()) == 0)
+      goto bad;
+  p->size = PIPEPAGES*PGSIZE;
+  p->readopen = 1;
+  p->writeopen = 1;
+  p->nwrite = 0;
+  p->nread = 0;
+  initlock(&p->lock, "pipe");
+  (*f0)->type = FD_PIPE;
+  (*f0)->readable = 1;
+  (*f0)->writable = 0;
+  (*f0)->pipe = p;
+  (*f1)->type = FD_PIPE;
+  (*f1)->readable = 0;
+  (*f1)->writable = 1;
+  (*f1)->pipe = p;
+  return 0;
+
+//PAGEBREAK: 20
+ bad:
+  if(p){
+    freering(p);
+    kfree((char*)p);
+  }
+  if(*f0)
+    fileclose(*f0);
+  if(*f1)
+    fileclose(*f1);
+  return -1;
+}
+
+void
+pipeclose(struct pipe *p, int writable)
+{
+  acquire(&p->lock);
+  if(writable){
+    p->writeopen = 0;
+    wakeup(&p->nread);
+  } else {
+    p->readopen = 0;
+    wakeup(&p->nwrite);
+  }
+  if(p->readopen == 0 && p->writeopen == 0){
+    release(&p->lock);
+    freering(p);
+    kfree((char*)p);
+  } else
+    release(&p->lock);
+}
+
+// Resize p's ring to hold at least n bytes, rounded up to a power
+// of two pages.  Only an empty pipe can be resized.  Returns the
+// new capacity, or -1.
+int
+pipesize(struct pipe *p, int n)
+{
+  char *page[NPIPEPAGE], *t;
+  int i, npage, old;
+
+  if(n < 1 || n > NPIPEPAGE*PGSIZE)
+    return -1;
+  for(npage = 1; npage*PGSIZE < n; npage *= 2)
+    ;
+  memset(page, 0, sizeof(page));
+  for(i = 0; i < npage; i++){
+    if((page[i] = kalloc()) == 0){
+      while(--i >= 0)
+        kfree(page[i]);
+      return -1;
+    }
+  }
+
+  acquire(&p->lock);
+  if(p->nread != p->nwrite || p->wrproc){
+    release(&p->lock);
+    for(i = 0; i < npage; i++)
+      kfree(page[i]);
+    return -1;
+  }
+  old = p->size / PGSIZE;
+  for(i = 0; i < NPIPEPAGE; i++){
+    t = p->page[i];
+    p->page[i] = page[i];
+    page[i] = t;
+  }
+  p->size = npage*PGSIZE;
+  p->nread = p->nwrite = 0;
+  release(&p->lock);
+
+  for(i = 0; i < old; i++)
+    kfree(page[i]);
+  return npage*PGSIZE;
+}
+
+// Post addr[0..n) for readers to copy from and wait until they
+// have.  Called with p->lock held; releases it.
+static int
+directwrite(struct pipe *p, char *addr, int n)
+{
+  int err;
+
+  p->wrproc = proc;
+  p->wrpgdir = proc->pgdir;
+  p->wraddr = (uint)addr;
+  p->wrlen = n;
+  p->wrerr = 0;
+  wakeup(&p->nread);
+  while(p->wrlen > 0){
+    if(p->readopen == 0 || proc->killed){
+      p->wrlen = 0;
+      p->wrerr = 1;
+      break;
+    }
+    sleep(&p->nwrite, &p->lock);
+  }
+  err = p->wrerr;
+  p->wrproc = 0;
+  p->wrpgdir = 0;
+  wakeup(&p->nwrite);  // writers waiting for us to finish
+  release(&p->lock);
+  return err ? -1 : n;
+}
+
+//PAGEBREAK: 40
+int
+pipewrite(struct pipe *p, char *addr, int n)
+{
+  int i, m;
+  uint off;
+
+  acquire(&p->lock);
+  for(i = 0; i < n; i += m){
+    while(p->wrproc || p->nwrite == p->nread + p->size){  //DOC: pipewrite-full
+      if(p->readopen == 0 || proc->killed){
+        release(&p->lock);
+        return -1;
+      }
+      wakeup(&p->nread);
+      sleep(&p->nwrite, &p->lock);  //DOC: pipewrite-sleep
+    }
+    if(PIPEDIRECT && i == 0 && p->nread == p->nwrite && n > p->size &&
+       (uint)addr % PGSIZE == 0 && n % PGSIZE == 0)
+      return directwrite(p, addr, n);
+    off = p->nwrite & (p->size - 1);
+    m = PGSIZE - off % PGSIZE;
+    if(m > n - i)
+      m = n - i;
+    if(m > p->size - (p->nwrite - p->nread))
+      m = p->size - (p->nwrite - p->nread);
+    memmove(p->page[off / PGSIZE] + off % PGSIZE, addr + i, m);
+    p->nwrite += m;
+  }
+  wakeup(&p->nread);  //DOC: pipewrite-wakeup1
+  release(&p->lock);
+  return n;
+}
+
+// Copy up to n bytes of the posted direct write into addr.
+// p->lock must be held.
+static int
+directread(struct pipe *p, char *addr, int n)
+{
+  char *src;
+  int i, m;
+
+  for(i = 0; i < n && p->wrlen > 0; i += m){
+    m = PGSIZE - p->wraddr % PGSIZE;
+    if(m > n - i)
+      m = n - i;
+    if(m > p->wrlen)
+      m = p->wrlen;
+    if((src = uva2ka(p->wrpgdir, (char*)PGROUNDDOWN(p->wraddr))) == 0){
+      p->wrlen = 0;
+      p->wrerr = 1;
+      break;
+    }
+    memmove(addr + i, src + p->wraddr % PGSIZE, m);
+    p->wraddr += m;
+    p->wrlen -= m;
+  }
+  return i;
+}
+
+int
+piperead(struct pipe *p, char *addr, int n)
+{
+  int i, m;
+  uint off;
+
+  acquire(&p->lock);
+  while(p->nread == p->nwrite && p->wrlen == 0 && p->writeopen){  //DOC: pipe-empty
+    if(proc->killed){
+      release(&p->lock);
+      return -1;
+    }
+    sleep(&p->nread, &p->lock); //DOC: piperead-sleep
+  }
+  if(p->wrlen > 0)
+    i = directread(p, addr, n);
+  else {
+    for(i = 0; i < n && p->nread != p->nwrite; i += m){  //DOC: piperead-copy
+      off = p->nread & (p->size - 1);
+      m = PGSIZE - off % PGSIZE;
+      if(m > n - i)
+        m = n - i;
+      if(m > p->nwrite - p->nread)
+        m = p->nwrite - p->nread;
+      memmove(addr + i, p->page[off / PGSIZE] + off % PGSIZE, m);
+      p->nread += m;
+    }
+  }
+  wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  release(&p->lock);
+  return i;
+}
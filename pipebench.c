@@ -0,0 +1,83 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "div64.h"
+
+// Pipe throughput against write size.
+// A writer child sends total KB through a pipe in writes of each
+// size to a reader reading the same size, for three kinds of pipe:
+//   pipebench ring ...    writes one byte off page alignment, so they
+//                         always go through the pipe's ring
+//   pipebench direct ...  page-aligned writes; whole pages too big
+//                         for the one-page ring go straight from the
+//                         writer's buffer to the reader's
+//   pipebench big ...     as ring, after pipesize() grows the ring to
+//                         64 KB
+// Prints size=S mbps=M for each write size (MB/s, 10^6 bytes).
+//
+// Usage: pipebench [totalkb]
+
+#define PGSIZE 4096
+#define MAXWRITE 65536
+
+static int sizes[] = { 64, 512, 4096, 16384, 65536 };
+static char *wbuf, *rbuf;
+
+// Page-aligned buffer of n bytes, with one spare byte.
+static char*
+alloc(int n)
+{
+  char *p;
+
+  p = sbrk(0);
+  sbrk(PGSIZE - (uint)p % PGSIZE + n + PGSIZE);
+  return p + PGSIZE - (uint)p % PGSIZE;
+}
+
+static void
+run(char *mode, int size, int total, int skew, int ring)
+{
+  int fd[2], n, got;
+  unsigned long long t0;
+  uint us;
+
+  pipe(fd);
+  if(ring && pipesize(fd[1], ring) < 0)
+    printf(2, "pipebench: pipesize failed\n");
+  t0 = nsnow();
+  if(fork() == 0){
+    close(fd[0]);
+    for(n = 0; n < total; n += size)
+      write(fd[1], wbuf + skew, size);
+    exit();
+  }
+  close(fd[1]);
+  for(got = 0; (n = read(fd[0], rbuf + skew, size)) > 0; got += n)
+    ;
+  close(fd[0]);
+  wait();
+  us = (uint)div64(nsnow() - t0, 1000, 0);
+  printf(1, "pipebench %s size=%d bytes=%d mbps=%d%s\n", mode, size, got,
+         us ? got / us : 0, got == total ? "" : " short");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int total = 4096, i;
+
+  if(argc > 1)
+    total = atoi(argv[1]);
+  total *= 1024;
+  wbuf = alloc(MAXWRITE);
+  rbuf = alloc(MAXWRITE);
+  memset(wbuf, 'x', MAXWRITE + 1);
+
+  for(i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+    run("ring", sizes[i], total, 1, 0);
+  for(i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+    run("direct", sizes[i], total, 0, 0);
+  for(i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+    run("big", sizes[i], total, 1, MAXWRITE);
+  exit();
+}
@@ -6,28 +6,122 @@
 #include "x86.h"
 #include "proc.h"
 #include "spinlock.h"
+#include "ticketlock.h"
+#include "lockstat.h"
+#include "pstat.h"
+#include "tsc.h"
+#include "prof.h"
+#include "wait.h"
+#include "mmap.h"
+#include "upage.h"
 
 #define PRIORITY_SCHEDULER 0  // Set to 1 for priority scheduling, 0 for round-robin
-#define MAX_PRIORITY 5        // Maximum priority level
+// Only ptable.lock is selectable: the lock a caller passes to sleep()
+// must be a spinlock, and tickslock is one for sleep(&ticks, ...).
+#define PTABLE_TICKETLOCK 0   // Set to 1 to guard ptable with a ticket lock, 0 for a spinlock
+#define NGROUP 8              // Maximum number of scheduling groups
+#define GROUP_SHARES 100      // CPU shares of the default group 0
+#define MAX_SHARES 10000
+#define STRIDE1 (1 << 16)     // Stride of a group with one share
+#define BALANCE_TICKS 10      // Ticks between load balancing passes per CPU
+#define TICKSKIP 1            // Set to 1 to skip needless timer preemption and halt idle CPUs
+#define RT_MAXPRIO 99         // Real-time priorities are 1..RT_MAXPRIO
+#define RT_MAXUTIL 950        // Admitted RT budget/period, in 1/1000 of a CPU
+
+// A scheduling group; see pickgroup().
+struct group {
+  int shares;                 // Relative CPU share; 0 if the slot is free
+  int nproc;                  // Member processes, including zombies
+  unsigned long long pass;    // CPU used so far, scaled by stride
+};
 
 struct {
+#if PTABLE_TICKETLOCK
+  struct ticketlock lock;
+#else
   struct spinlock lock;
+#endif
   struct proc proc[NPROC];
   struct proc *priority_head[MAX_PRIORITY]; // Tail pointers for circular lists
+  struct group group[NGROUP];  // Scheduling groups; group 0 is the default
+  uint rtstamp;                // Orders RT processes by when they became RUNNABLE
+  struct proc *dlheap[NPROC];  // RUNNABLE deadline processes, earliest deadline first
+  int ndl;                     // Entries in dlheap
 } ptable;
 
+#if PTABLE_TICKETLOCK
+#define ptable_acquire()  tacquire(&ptable.lock)
+#define ptable_release()  trelease(&ptable.lock)
+#define ptable_holding()  tholding(&ptable.lock)
+#else
+#define ptable_acquire()  lockstat_acquire(&ptable.lock)
+#define ptable_release()  lockstat_release(&ptable.lock)
+#define ptable_holding()  holding(&ptable.lock)
+#endif
+
 static struct proc *initproc;
 
 int nextpid = 1;
 extern void forkret(void);
 extern void trapret(void);
 
+static void sleep1(void *chan);
+static void leavegroup(struct proc *p);
+static void dlrunnable(struct proc *p, int wasrunning);
+static int idlestcpu(void);
+static int spawn(struct proc *np);
+static char *reap(struct proc *p);
+static int sharedvm(struct proc *p);
 static void wakeup1(void *chan);
 
+// The fields that monitoring reads without ptable.lock (state, pid,
+// parent, nice, name, nsched) are published through p->seq, a
+// sequence counter.  A writer makes seq odd while it changes them;
+// a reader copies the fields and retries unless it saw the same even
+// seq before and after (see readproc).  Writers hold ptable.lock or
+// own the slot (EMBRYO), so there is only ever one writer per proc.
+static inline void
+seq_begin(struct proc *p)
+{
+  p->seq++;
+  __sync_synchronize();
+}
+
+static inline void
+seq_end(struct proc *p)
+{
+  __sync_synchronize();
+  p->seq++;
+}
+
+static inline void
+setstate(struct proc *p, enum procstate state)
+{
+  int wasrunning = p->state == RUNNING;
+
+  seq_begin(p);
+  p->state = state;
+  seq_end(p);
+  if(state == RUNNABLE){
+    p->rtstamp = ptable.rtstamp++;  // FIFO position, see pickrt()
+    if(p->dlperiod)
+      dlrunnable(p, wasrunning);
+  }
+}
+
 void
 pinit(void)
 {
+#if PTABLE_TICKETLOCK
+  initticketlock(&ptable.lock, "ptable");
+#else
   initlock(&ptable.lock, "ptable");
+#endif
+  lockstat_register(&ptable.lock, "ptable");
+  lockstat_register(&tickslock, "time");  // initialized later by tvinit()
+  ptable.group[0].shares = GROUP_SHARES;
+  profinit();
+  vmainit();
   #if PRIORITY_SCHEDULER
     int i;
     for (i = 0; i < MAX_PRIORITY; i++) {
@@ -82,6 +176,153 @@ void remove_from_priority_queue(struct proc *p) {
 }
 #endif
 
+// Deadline heap.
+// A process that reserved dlruntime ticks every dlperiod ticks with
+// deadline() runs as a series of jobs; each job must get its runtime
+// before its absolute deadline dldeadline.  While it is RUNNABLE with
+// budget left it sits in ptable.dlheap, a binary min-heap ordered by
+// dldeadline, and scheduler() runs the top of the heap ahead of every
+// other class (earliest deadline first).  p->dlidx is its slot in
+// the heap, -1 if it is not there.
+
+static int
+dlbefore(struct proc *a, struct proc *b)
+{
+  return (int)(a->dldeadline - b->dldeadline) < 0;
+}
+
+static void
+dlswap(int i, int j)
+{
+  struct proc *p;
+
+  p = ptable.dlheap[i];
+  ptable.dlheap[i] = ptable.dlheap[j];
+  ptable.dlheap[j] = p;
+  ptable.dlheap[i]->dlidx = i;
+  ptable.dlheap[j]->dlidx = j;
+}
+
+// Restore heap order around slot i.
+static void
+dlfix(int i)
+{
+  int c;
+
+  while(i > 0 && dlbefore(ptable.dlheap[i], ptable.dlheap[(i-1)/2])){
+    dlswap(i, (i-1)/2);
+    i = (i-1)/2;
+  }
+  for(;;){
+    c = 2*i + 1;
+    if(c >= ptable.ndl)
+      break;
+    if(c+1 < ptable.ndl && dlbefore(ptable.dlheap[c+1], ptable.dlheap[c]))
+      c++;
+    if(!dlbefore(ptable.dlheap[c], ptable.dlheap[i]))
+      break;
+    dlswap(i, c);
+    i = c;
+  }
+}
+
+static void
+dlpush(struct proc *p)
+{
+  p->dlidx = ptable.ndl++;
+  ptable.dlheap[p->dlidx] = p;
+  dlfix(p->dlidx);
+}
+
+static void
+dlremove(struct proc *p)
+{
+  int i;
+
+  i = p->dlidx;
+  p->dlidx = -1;
+  if(--ptable.ndl == i)
+    return;
+  ptable.dlheap[i] = ptable.dlheap[ptable.ndl];
+  ptable.dlheap[i]->dlidx = i;
+  dlfix(i);
+}
+
+// Start the next job of deadline process p if the deadline of the
+// current one has passed.  If p still wanted the CPU (active) and
+// had not yet had its reserved runtime, the job missed its deadline;
+// a job that got its full budget did not, however long it ran on.
+static void
+dlnext(struct proc *p, int active)
+{
+  if((int)(ticks - p->dldeadline) < 0)
+    return;
+  if(active && p->dlused < p->dlruntime){
+    seq_begin(p);
+    p->dlmiss++;
+    seq_end(p);
+  }
+  p->dldeadline = ticks + p->dlperiod;
+  p->dlused = 0;
+}
+
+// Deadline process p just became RUNNABLE: queue it by deadline if
+// it has budget left.  One that spent its budget competes as an
+// ordinary process until its next job starts.
+static void
+dlrunnable(struct proc *p, int wasrunning)
+{
+  dlnext(p, wasrunning);
+  if(p->dlused < p->dlruntime && p->dlidx < 0)
+    dlpush(p);
+}
+
+// Set p's effective nice value, moving it to the matching
+// priority queue if it is on one.  The ptable lock must be held.
+static void
+renice(struct proc *p, int nice)
+{
+  #if PRIORITY_SCHEDULER
+  int queued = p->next != 0;
+  if(queued)
+    remove_from_priority_queue(p);
+  #endif
+
+  seq_begin(p);
+  p->nice = nice;
+  seq_end(p);
+
+  #if PRIORITY_SCHEDULER
+  if(queued)
+    add_to_priority_queue(p);
+  #endif
+}
+
+// Priority inheritance for sleep locks.
+// A process blocked in sleep_pi() records the lock holder in
+// pi_holder.  A holder runs at the best (lowest) nice among its own
+// base_nice and those of the processes blocked on it, so background
+// work holding a lock cannot be starved while a nice 1 process waits
+// for it.  Boosts propagate along chains of blocked holders.
+// The ptable lock must be held.
+static void
+pi_update(struct proc *p)
+{
+  struct proc *q;
+  int depth, nice;
+
+  for(depth = 0; p && depth < NPROC; depth++){
+    nice = p->base_nice;
+    for(q = ptable.proc; q < &ptable.proc[NPROC]; q++)
+      if(q->pi_holder == p && q->nice < nice)
+        nice = q->nice;
+    if(nice == p->nice)
+      break;
+    renice(p, nice);
+    p = p->pi_holder;
+  }
+}
+
 //PAGEBREAK: 32
 // Look in the process table for an UNUSED proc.
 // If found, change state to EMBRYO and initialize
@@ -93,25 +334,45 @@ allocproc(void)
   struct proc *p;
   char *sp;
 
-  acquire(&ptable.lock);
+  ptable_acquire();
 
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
     if(p->state == UNUSED)
       goto found;
 
-  release(&ptable.lock);
+  ptable_release();
   return 0;
 
 found:
+  seq_begin(p);
   p->state = EMBRYO;
   p->pid = nextpid++;
   p->nice = 3; //Default value for processes = 3
-
-  release(&ptable.lock);
+  p->base_nice = 3;
+  p->pi_holder = 0;
+  p->pi_chan = 0;
+  p->gid = 0;  // joined by userinit() or fork()
+  p->rtprio = 0;  // the real-time class is not inherited
+  p->dlperiod = 0;  // nor is a deadline reservation
+  p->dlidx = -1;
+  p->dlmiss = 0;
+  p->cpu = 0;
+  p->nmigrate = 0;
+  p->thread = 0;
+  p->ustack = 0;
+  p->xstate = 0;
+  p->pgid = p->pid;
+  memset(p->vma, 0, sizeof(p->vma));
+  p->vmabusy = 0;
+  p->nsched = 0;
+  p->cycles = 0;
+  seq_end(p);
+
+  ptable_release();
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    setstate(p, UNUSED);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -147,6 +408,8 @@ userinit(void)
   if((p->pgdir = setupkvm()) == 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
+  if(setupupage(p->pgdir, p->pid) < 0)
+    panic("userinit: out of memory?");
   p->sz = PGSIZE;
   memset(p->tf, 0, sizeof(*p->tf));
   p->tf->cs = (SEG_UCODE << 3) | DPL_USER;
@@ -157,21 +420,24 @@ userinit(void)
   p->tf->esp = PGSIZE;
   p->tf->eip = 0;  // beginning of initcode.S
 
+  seq_begin(p);
   safestrcpy(p->name, "initcode", sizeof(p->name));
+  seq_end(p);
   p->cwd = namei("/");
 
   // this assignment to p->state lets other cores
   // run this process. the acquire forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
+  ptable_acquire();
 
-  p->state = RUNNABLE;
+  ptable.group[0].nproc++;
+  setstate(p, RUNNABLE);
   #if PRIORITY_SCHEDULER
   add_to_priority_queue(p); //Add process to queue
   #endif
 
-  release(&ptable.lock);
+  ptable_release();
 }
 
 // Grow current process's memory by n bytes.
@@ -180,16 +446,41 @@ int
 growproc(int n)
 {
   uint sz;
+  struct proc *p;
+  int shared;
+
+  // Threads sharing the address space grow it one at a time and all
+  // see the new size.  lockvma() serializes them, and page faults on
+  // file mappings, without holding ptable.lock across allocuvm().
+  // It cannot shrink while shared: other CPUs might still hold the
+  // freed pages in their TLB.  (Only a member of the group can
+  // clone() a new one, so sharing cannot start behind our back.)
+  ptable_acquire();
+  shared = sharedvm(proc);
+  ptable_release();
+  if(shared && n < 0)
+    return -1;
 
+  lockvma(proc);
   sz = proc->sz;
   if(n > 0){
-    if((sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
-      return -1;
-  } else if(n < 0){
-    if((sz = deallocuvm(proc->pgdir, sz, sz + n)) == 0)
-      return -1;
-  }
-  proc->sz = sz;
+    if(sz + n > vmabase(proc) ||
+       (sz = allocuvm(proc->pgdir, sz, sz + n)) == 0)
+      sz = 0;
+  } else if(n < 0)
+    sz = deallocuvm(proc->pgdir, sz, sz + n);
+
+  if(sz && shared){
+    ptable_acquire();
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+      if(p->pgdir == proc->pgdir)
+        p->sz = sz;
+    ptable_release();
+  } else if(sz)
+    proc->sz = sz;
+  unlockvma(proc);
+  if(sz == 0)
+    return -1;
   switchuvm(proc);
   return 0;
 }
@@ -200,7 +491,6 @@ growproc(int n)
 int
 fork(void)
 {
-  int i, pid;
   struct proc *np;
 
   // Allocate process.
@@ -212,34 +502,57 @@ fork(void)
   if((np->pgdir = copyuvm(proc->pgdir, proc->sz)) == 0){
     kfree(np->kstack);
     np->kstack = 0;
-    np->state = UNUSED;
+    setstate(np, UNUSED);
+    return -1;
+  }
+  if(setupupage(np->pgdir, np->pid) < 0 || vmafork(np) < 0){
+    freevm(np->pgdir);
+    np->pgdir = 0;
+    kfree(np->kstack);
+    np->kstack = 0;
+    setstate(np, UNUSED);
     return -1;
   }
   np->sz = proc->sz;
   np->parent = proc;
   *np->tf = *proc->tf;
-  np->nice = proc->nice;
 
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
+  return spawn(np);
+}
+
+// Give new child np of the current process its files, scheduling
+// parameters and a CPU, and make it RUNNABLE.  Returns its pid.
+static int
+spawn(struct proc *np)
+{
+  int i, pid;
+
   for(i = 0; i < NOFILE; i++)
     if(proc->ofile[i])
       np->ofile[i] = filedup(proc->ofile[i]);
   np->cwd = idup(proc->cwd);
 
-  safestrcpy(np->name, proc->name, sizeof(proc->name));
-
   pid = np->pid;
 
-  acquire(&ptable.lock);
+  ptable_acquire();
 
+  seq_begin(np);
+  np->nice = np->base_nice = proc->base_nice; // Lent priority is not inherited
+  safestrcpy(np->name, proc->name, sizeof(proc->name));
+  np->gid = proc->gid;  // The child joins its parent's group
+  np->pgid = proc->pgid;
+  np->cpu = idlestcpu();
   np->state = RUNNABLE;
+  seq_end(np);
+  ptable.group[np->gid].nproc++;
   #if PRIORITY_SCHEDULER
   add_to_priority_queue(np);
   #endif
 
-  release(&ptable.lock);
+  ptable_release();
 
   return pid;
 }
@@ -251,7 +564,8 @@ void
 exit(void)
 {
   struct proc *p;
-  int fd;
+  pde_t *pgdir;
+  int fd, shared;
 
   if(proc == initproc)
     panic("init exiting");
@@ -263,13 +577,28 @@ exit(void)
       proc->ofile[fd] = 0;
     }
   }
+  vmaexit(proc);
 
   begin_op();
   iput(proc->cwd);
   end_op();
   proc->cwd = 0;
 
-  acquire(&ptable.lock);
+  // Free the address space here rather than in wait(), so the
+  // parent does not walk it with ptable.lock held -- unless other
+  // threads still use it; the last one out frees it.  From here on
+  // we run on kpgdir; yield() leaves a process without a pgdir
+  // alone, since switchuvm() could not switch back to it.
+  switchkvm();
+  ptable_acquire();
+  shared = sharedvm(proc);
+  pgdir = proc->pgdir;
+  proc->pgdir = 0;
+  ptable_release();
+  if(!shared)
+    freevm(pgdir);
+
+  ptable_acquire();
 
   // Parent might be sleeping in wait().
    // Notify that the process is exiting
@@ -279,14 +608,37 @@ exit(void)
 
   // Pass abandoned children to init.
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    // Nobody can lend priority to us any more.
+    if(p->pi_holder == proc)
+      p->pi_holder = 0;
     if(p->parent == proc){
+      // Threads die with the process that created them.
+      if(p->thread){
+        p->killed = 1;
+        if(p->state == SLEEPING)
+          setstate(p, RUNNABLE);
+      }
+      seq_begin(p);
       p->parent = initproc;
+      seq_end(p);
       if(p->state == ZOMBIE)
         wakeup1(initproc);
         //cprintf("Process %d woke up init parent %d\n", proc->pid, proc->parent->pid);
     }
   }
 
+  // The rest of the thread group dies with its leader, including
+  // threads that other threads created.
+  if(shared && !proc->thread){
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+      if(p->pgdir == pgdir && p->thread){
+        p->killed = 1;
+        if(p->state == SLEEPING)
+          setstate(p, RUNNABLE);
+      }
+    }
+  }
+
   // Remove the process from the priority queue
   #if PRIORITY_SCHEDULER
   remove_from_priority_queue(proc);
@@ -295,7 +647,7 @@ exit(void)
 
 
   // Jump into the scheduler, never to return.
-  proc->state = ZOMBIE;
+  setstate(proc, ZOMBIE);
   //cprintf("Process %d set to ZOMBIE\n", proc->pid);
   sched();
   panic("zombie exit");
@@ -308,13 +660,15 @@ wait(void)
 {
   struct proc *p;
   int havekids, pid;
+  char *kstack;
 
-  acquire(&ptable.lock);
+  ptable_acquire();
   for(;;){
     // Scan through table looking for exited children.
     havekids = 0;
     for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != proc)
+      // Threads are collected by join(); init reaps orphaned ones.
+      if(p->parent != proc || (p->thread && proc != initproc))
         continue;
       havekids = 1;
       if(p->state == ZOMBIE){
@@ -322,30 +676,667 @@ wait(void)
         //remove_from_priority_queue(p); //redundant check remove if problems
         // Found one.
         pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
-        release(&ptable.lock);
+        kstack = reap(p);
+        ptable_release();
+        kfree(kstack);
         return pid;
       }
     }
 
     // No point waiting if we don't have any children.
     if(!havekids || proc->killed){
-      release(&ptable.lock);
+      ptable_release();
       return -1;
     }
 
     // Wait for children to exit.  (See wakeup1 call in proc_exit.)
     //cprintf("Parent %d going to sleep in wait()\n", proc->pid);
-    sleep(proc, &ptable.lock);  //DOC: wait-sleep
+    sleep1(proc);  //DOC: wait-sleep
+  }
+}
+
+// Scheduling groups.
+// Every process belongs to a group (p->gid, inherited across fork);
+// group 0 holds everything not placed elsewhere.  scheduler() first
+// picks the group with a RUNNABLE member that has used the least CPU
+// relative to its shares (stride scheduling: a group's pass advances
+// by its stride, STRIDE1/shares, per unit of CPU time it gets), then
+// a process within that group.  So two jobs with equal shares get
+// equal CPU however many processes each of them forks.
+
+// Pick the group to run next on this CPU, or -1 if nothing is runnable.
+static int
+pickgroup(void)
+{
+  struct proc *p;
+  int g, best;
+  char runnable[NGROUP];
+
+  memset(runnable, 0, sizeof(runnable));
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state == RUNNABLE && p->cpu == cpu - cpus)
+      runnable[p->gid] = 1;
+
+  best = -1;
+  for(g = 0; g < NGROUP; g++)
+    if(runnable[g] &&
+       (best < 0 || ptable.group[g].pass < ptable.group[best].pass))
+      best = g;
+
+  // A group with nothing to run must not bank credit while idle,
+  // or it would monopolize the CPU when it wakes up.
+  if(best >= 0)
+    for(g = 0; g < NGROUP; g++)
+      if(!runnable[g] && ptable.group[g].pass < ptable.group[best].pass)
+        ptable.group[g].pass = ptable.group[best].pass;
+  return best;
+}
+
+// Pick a RUNNABLE process in group g that belongs to this CPU, or 0.
+static struct proc*
+pickproc(int g)
+{
+  struct proc *p;
+
+  #if PRIORITY_SCHEDULER  // Priority Scheduling
+  int priority;
+       // Iterate over each priority level from highest (1) to lowest (MAX_PRIORITY)
+  for (priority = 0; priority < MAX_PRIORITY; priority++) {
+    struct proc *head = ptable.priority_head[priority];
+
+    // Skip to the next priority level if this one is empty
+    if (!head) continue;
+
+    p = head;
+
+    do {
+      if (p->state == RUNNABLE && p->gid == g && p->cpu == cpu - cpus) {
+        // Found a RUNNABLE process; schedule it
+        ptable.priority_head[priority] = p->next;  // Rotate the queue
+        return p;
+      }
+      p = p->next;
+    } while (p != head);  // Complete a full rotation if needed
+  }
+
+  #else  // Round Robin Scheduling
+  int i;
+
+  // Resume the scan after the process picked last time, so that
+  // every RUNNABLE process gets its turn.
+  for(i = 1; i <= NPROC; i++){
+    p = &ptable.proc[(cpu->rr + i) % NPROC];
+    if(p->state == RUNNABLE && p->gid == g && p->cpu == cpu - cpus){
+      cpu->rr = p - ptable.proc;
+      return p;
+    }
+  }
+
+  #endif
+  return 0;
+}
+
+// Charge group g for cycles of CPU time.
+static void
+charge(int g, unsigned long long cycles)
+{
+  ptable.group[g].pass += (cycles >> 10) * (STRIDE1 / ptable.group[g].shares);
+}
+
+// Drop p from its group, freeing the group if p was its
+// last member.  The ptable lock must be held.
+static void
+leavegroup(struct proc *p)
+{
+  if(--ptable.group[p->gid].nproc == 0 && p->gid != 0)
+    ptable.group[p->gid].shares = 0;
+}
+
+// Move p into group g.  The ptable lock must be held.
+static void
+setgroup(struct proc *p, int g)
+{
+  leavegroup(p);
+  seq_begin(p);
+  p->gid = g;
+  seq_end(p);
+  ptable.group[g].nproc++;
+}
+
+// Create a group with the given CPU shares and move the
+// current process into it; its future children follow.
+// Returns the new group id, or -1.
+int
+grpcreate(int shares)
+{
+  struct group *gr;
+  int g;
+
+  if(shares < 1 || shares > MAX_SHARES)
+    return -1;
+  ptable_acquire();
+  for(g = 1; g < NGROUP; g++){
+    gr = &ptable.group[g];
+    if(gr->shares == 0){
+      gr->shares = shares;
+      gr->nproc = 0;
+      gr->pass = ptable.group[proc->gid].pass;  // no head start
+      setgroup(proc, g);
+      ptable_release();
+      return g;
+    }
+  }
+  ptable_release();
+  return -1;
+}
+
+// Move process pid into existing group gid.
+int
+grpjoin(int pid, int gid)
+{
+  struct proc *p;
+
+  if(gid < 0 || gid >= NGROUP)
+    return -1;
+  ptable_acquire();
+  if(ptable.group[gid].shares == 0){
+    ptable_release();
+    return -1;
+  }
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->state != EMBRYO &&
+       p->state != ZOMBIE){
+      if(p->gid != gid)
+        setgroup(p, gid);
+      ptable_release();
+      return 0;
+    }
+  }
+  ptable_release();
+  return -1;
+}
+
+// Load balancing.
+// Each process belongs to one CPU (p->cpu), and a CPU only picks
+// ordinary processes of its own (the deadline and RT classes are
+// global).  fork() places a child on the least loaded CPU.  Every
+// BALANCE_TICKS ticks, and whenever it has nothing to run, a CPU
+// compares its load with the busiest CPU and pulls over a RUNNABLE
+// process if that evens things out.  Load is the weight of a CPU's
+// RUNNABLE and RUNNING processes, where a nice 1 process weighs 16
+// and each nice level above halves that.
+
+static int
+loadweight(struct proc *p)
+{
+  return 1 << (MAX_PRIORITY - p->nice);
+}
+
+// Fill load[] with the load of each CPU.
+static void
+cpuload(int *load)
+{
+  struct proc *p;
+  int c;
+
+  for(c = 0; c < ncpu; c++)
+    load[c] = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state == RUNNABLE || p->state == RUNNING)
+      load[p->cpu] += loadweight(p);
+}
+
+// The least loaded CPU, for a new process.
+static int
+idlestcpu(void)
+{
+  int load[NCPU], c, best;
+
+  cpuload(load);
+  best = 0;
+  for(c = 1; c < ncpu; c++)
+    if(load[c] < load[best])
+      best = c;
+  return best;
+}
+
+// Pull the heaviest RUNNABLE process from the busiest CPU to this
+// one whose move narrows the gap between them.
+// Returns whether it moved one.
+static int
+balance(void)
+{
+  struct proc *p, *best;
+  int load[NCPU], me, c, busiest, w;
+
+  me = cpu - cpus;
+  cpu->lastbalance = ticks;
+  cpuload(load);
+  busiest = me;
+  for(c = 0; c < ncpu; c++)
+    if(load[c] > load[busiest])
+      busiest = c;
+  if(busiest == me)
+    return 0;
+
+  best = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state != RUNNABLE || p->cpu != busiest)
+      continue;
+    w = loadweight(p);
+    if(2*w <= load[busiest] - load[me] && (best == 0 || w > loadweight(best)))
+      best = p;
+  }
+  if(best == 0)
+    return 0;
+  seq_begin(best);
+  best->cpu = me;
+  best->nmigrate++;
+  seq_end(best);
+  cpu->nmigrate++;
+  return 1;
+}
+
+// Copy per-CPU statistics for up to n CPUs into st.
+// Returns the number of CPUs.
+int
+cpustat(struct cpustat *st, int n)
+{
+  int load[NCPU], c;
+
+  ptable_acquire();
+  cpuload(load);
+  for(c = 0; c < ncpu && c < n; c++){
+    st[c].busy = cycles2ns(cpus[c].busy);
+    st[c].nsched = cpus[c].nsched;
+    st[c].nmigrate = cpus[c].nmigrate;
+    st[c].load = load[c];
+    st[c].ntickskip = cpus[c].ntickskip;
+    st[c].nsamevm = cpus[c].nsamevm;
+  }
+  ptable_release();
+  return c;
+}
+
+// Real-time FIFO class.
+// A process admitted with rtsched() (p->rtprio > 0) runs ahead of
+// every group and nice level; among RT processes the highest rtprio
+// wins, and equal priorities run first come, first served.  An RT
+// process is not preempted by the timer, only by a higher rtprio, so
+// it runs until it blocks or yields -- but at most rtbudget ticks per
+// rtperiod ticks.  Once its budget is spent it competes as an ordinary
+// process in its group until the next period starts, so a runaway RT
+// loop cannot lock up the CPU.
+
+// Start a new period for RT process p if the current one is over.
+// Returns whether p has budget left.
+static int
+rtready(struct proc *p)
+{
+  if(ticks - p->rtstart >= p->rtperiod){
+    p->rtstart = ticks;
+    p->rtused = 0;
+  }
+  return p->rtused < p->rtbudget;
+}
+
+// Pick the RUNNABLE RT process with budget left to run next, or 0.
+static struct proc*
+pickrt(void)
+{
+  struct proc *p, *best;
+
+  best = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->state != RUNNABLE || p->rtprio == 0 || !rtready(p))
+      continue;
+    if(best == 0 || p->rtprio > best->rtprio ||
+       (p->rtprio == best->rtprio && (int)(p->rtstamp - best->rtstamp) < 0))
+      best = p;
+  }
+  return best;
+}
+
+// CPU reserved by RT and deadline processes other than skip,
+// in 1/1000 of a CPU.
+static int
+reserved(struct proc *skip)
+{
+  struct proc *q;
+  int util;
+
+  util = 0;
+  for(q = ptable.proc; q < &ptable.proc[NPROC]; q++){
+    if(q == skip || q->state == UNUSED || q->state == ZOMBIE)
+      continue;
+    if(q->rtprio > 0)
+      util += q->rtbudget * 1000 / q->rtperiod;
+    if(q->dlperiod)
+      util += q->dlruntime * 1000 / q->dlperiod;
+  }
+  return util;
+}
+
+// Put process pid in the RT class at priority prio with a budget of
+// budget ticks every period ticks, or back in the normal class if
+// prio is 0.  Admission fails if the RT and deadline reservations
+// would add up to more than RT_MAXUTIL of a CPU.
+int
+rtsched(int pid, int prio, int budget, int period)
+{
+  struct proc *p;
+
+  if(prio < 0 || prio > RT_MAXPRIO)
+    return -1;
+  if(prio > 0 && (budget < 1 || period < budget))
+    return -1;
+  ptable_acquire();
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->pid == pid && p->state != UNUSED && p->state != ZOMBIE)
+      break;
+  if(p == &ptable.proc[NPROC] || p->dlperiod){
+    ptable_release();
+    return -1;
+  }
+  if(prio > 0){
+    if(reserved(p) + budget * 1000 / period > RT_MAXUTIL){
+      ptable_release();
+      return -1;
+    }
+    p->rtbudget = budget;
+    p->rtperiod = period;
+    p->rtstart = ticks;
+    p->rtused = 0;
+  }
+  p->rtprio = prio;
+  ptable_release();
+  return 0;
+}
+
+// Reserve runtime ticks of CPU every period ticks for the current
+// process, scheduled earliest deadline first, or drop the reservation
+// if period is 0.  Fails for RT processes and if the reservations
+// would exceed RT_MAXUTIL.
+int
+deadline(int runtime, int period)
+{
+  ptable_acquire();
+  if(period == 0){
+    proc->dlperiod = 0;  // proc is RUNNING, so it is not in the heap
+    ptable_release();
+    return 0;
+  }
+  if(runtime < 1 || period < runtime || proc->rtprio > 0 ||
+     reserved(proc) + runtime * 1000 / period > RT_MAXUTIL){
+    ptable_release();
+    return -1;
   }
+  proc->dlruntime = runtime;
+  proc->dlperiod = period;
+  proc->dldeadline = ticks + period;
+  proc->dlused = 0;
+  ptable_release();
+  return 0;
+}
+
+// Pick the next process for this CPU, or 0: deadline processes
+// first, then real-time ones; otherwise pick a group by share,
+// then a process within it.
+static struct proc*
+pick(void)
+{
+  struct proc *p;
+  int g;
+
+  if(ptable.ndl > 0)
+    return ptable.dlheap[0];
+  if((p = pickrt()) != 0)
+    return p;
+  if((g = pickgroup()) >= 0)
+    return pickproc(g);
+  return 0;
+}
+
+// Reap up to max exited children in one pass over the table,
+// storing their pids and exit statuses (see exitstatus).  Unless
+// flags has WNOHANG, sleeps until at least one child has exited.
+// Returns the number reaped, 0 if WNOHANG and none had exited,
+// or -1 if there are no children.
+int
+waitn(int *pids, int *statuses, int max, int flags)
+{
+  struct proc *p;
+  char *kstack[NPROC];
+  int havekids, n, i;
+
+  if(max > NPROC)
+    max = NPROC;
+  ptable_acquire();
+  for(;;){
+    havekids = 0;
+    n = 0;
+    for(p = ptable.proc; p < &ptable.proc[NPROC] && n < max; p++){
+      if(p->parent != proc || (p->thread && proc != initproc))
+        continue;
+      havekids = 1;
+      if(p->state == ZOMBIE){
+        pids[n] = p->pid;
+        statuses[n] = p->xstate;
+        kstack[n++] = reap(p);
+      }
+    }
+    if(n > 0 || !havekids || proc->killed || (flags & WNOHANG))
+      break;
+    sleep1(proc);  // See wakeup1 call in exit.
+  }
+  ptable_release();
+
+  for(i = 0; i < n; i++)
+    kfree(kstack[i]);
+  if(n == 0 && (!havekids || proc->killed))
+    return -1;
+  return n;
+}
+
+// Free zombie p's slot.  exit() already freed the address space;
+// returns the kernel stack, for the caller to free once it has
+// dropped the ptable lock.
+static char*
+reap(struct proc *p)
+{
+  char *kstack;
+
+  kstack = p->kstack;
+  p->kstack = 0;
+  leavegroup(p);
+  seq_begin(p);
+  p->pid = 0;
+  p->parent = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->state = UNUSED;
+  seq_end(p);
+  return kstack;
+}
+
+// Whether a live process other than p uses p's address space.
+// The ptable lock must be held.
+static int
+sharedvm(struct proc *p)
+{
+  struct proc *q;
+
+  for(q = ptable.proc; q < &ptable.proc[NPROC]; q++)
+    if(q != p && q->pgdir == p->pgdir && q->state != UNUSED)
+      return 1;
+  return 0;
+}
+
+// Whether a live process other than p uses p's address space,
+// for callers outside proc.c.
+int
+vmshared(struct proc *p)
+{
+  int shared;
+
+  ptable_acquire();
+  shared = sharedvm(p);
+  ptable_release();
+  return shared;
+}
+
+// exec(): give the current process the new image pgdir of sz bytes
+// and its name.  The check for threads and the switch happen under
+// ptable.lock, so no clone() can start sharing the old image in
+// between.  Returns the old page table, or 0 if threads share it.
+pde_t*
+execimage(pde_t *pgdir, uint sz, char *name)
+{
+  pde_t *old;
+
+  ptable_acquire();
+  if(sharedvm(proc)){
+    ptable_release();
+    return 0;
+  }
+  old = proc->pgdir;
+  seq_begin(proc);
+  proc->pgdir = pgdir;
+  proc->sz = sz;
+  safestrcpy(proc->name, name, sizeof(proc->name));
+  seq_end(proc);
+  ptable_release();
+  return old;
+}
+
+// Threads.
+// clone() creates a process that shares the caller's address space
+// (pgdir and sz) and starts it at fn(arg) on the one-page user stack
+// stack.  Open files are shared the way fork() shares them.  The
+// thread is a child of the caller, collected by join() rather than
+// wait(), and is killed when the process that created it exits.
+
+// Create a thread running fn(arg) on stack.  Returns its pid.
+int
+clone(void (*fn)(void*), void *arg, void *stack)
+{
+  struct proc *np;
+  uint ustack[2], sp;
+
+  if((np = allocproc()) == 0)
+    return -1;
+  np->pgdir = proc->pgdir;
+  np->sz = proc->sz;
+  np->parent = proc;
+  np->thread = 1;
+  np->ustack = stack;
+  *np->tf = *proc->tf;
+
+  // Fake return PC, then the argument.
+  ustack[0] = 0xffffffff;
+  ustack[1] = (uint)arg;
+  sp = (uint)stack + PGSIZE - sizeof(ustack);
+  if(copyout(np->pgdir, sp, ustack, sizeof(ustack)) < 0){
+    kfree(np->kstack);
+    np->kstack = 0;
+    np->pgdir = 0;
+    setstate(np, UNUSED);
+    return -1;
+  }
+  np->tf->eax = 0;
+  np->tf->eip = (uint)fn;
+  np->tf->esp = sp;
+  setupid(np->pgdir, 0);  // getpid() must ask the kernel now
+
+  return spawn(np);
+}
+
+// Wait for a thread of the current process to exit and store the
+// stack it was given in *stack.  Returns its pid, or -1 if there
+// are no threads.
+int
+join(void **stack)
+{
+  struct proc *p;
+  int havethreads, pid;
+  char *kstack;
+
+  ptable_acquire();
+  for(;;){
+    havethreads = 0;
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+      if(p->parent != proc || !p->thread)
+        continue;
+      havethreads = 1;
+      if(p->state == ZOMBIE){
+        pid = p->pid;
+        *stack = p->ustack;
+        kstack = reap(p);
+        ptable_release();
+        kfree(kstack);
+        return pid;
+      }
+    }
+    if(!havethreads || proc->killed){
+      ptable_release();
+      return -1;
+    }
+    sleep1(proc);
+  }
+}
+
+// Switch to p and run it until it gives the CPU back,
+// charging the cycles it ran to p->cycles.  If p uses the
+// address space still loaded in cr3 (loaded), only the kernel
+// stack for traps changes.  Leaves p's address space loaded.
+// Returns the cycles p ran.
+// Called from scheduler() with ptable.lock held.
+static unsigned long long
+run(struct proc *p, pde_t *loaded)
+{
+  unsigned long long start, used;
+
+  if(p->dlidx >= 0)
+    dlremove(p);
+  proc = p;
+  if(p->pgdir == loaded){
+    cpu->ts.esp0 = (uint)p->kstack + KSTACKSIZE;
+    cpu->nsamevm++;
+  } else
+    switchuvm(p);
+  seq_begin(p);
+  p->state = RUNNING;
+  p->nsched++;
+  seq_end(p);
+  start = rdtsc();
+  swtch(&cpu->scheduler, p->context);
+  used = rdtsc() - start;
+  seq_begin(p);
+  p->cycles += used;
+  seq_end(p);
+  cpu->busy += used;
+  cpu->nsched++;
+  proc = 0;  // Reset proc after process finishes or yields
+  return used;
+}
+
+#if TICKSKIP
+// Whether nothing but proc, if any, could run on this CPU now: a
+// timer tick need not take proc through scheduler() only to pick it
+// again, and an idle CPU can halt.  The ptable lock must be held.
+static int
+alone(void)
+{
+  struct proc *p;
+
+  if(ptable.ndl > 0 || ticks - cpu->lastbalance >= BALANCE_TICKS)
+    return 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+    if(p->state == RUNNABLE && (p->cpu == cpu - cpus || p->rtprio > 0))
+      return 0;
+  return 1;
 }
+#endif
 
 //PAGEBREAK: 42
 // Per-CPU process scheduler.
@@ -358,73 +1349,55 @@ wait(void)
 void scheduler(void)
 {
   struct proc *p;
+  pde_t *loaded;
+  int n, found;
 
   for(;;){
     sti();  // Enable interrupts on this processor.
-    acquire(&ptable.lock);
-
-    #if PRIORITY_SCHEDULER  // Priority Scheduling
-    int priority;
-    int found_runnable = 0;
-       // Iterate over each priority level from highest (1) to lowest (MAX_PRIORITY)
-    for (priority = 0; priority < MAX_PRIORITY; priority++) {
-      struct proc *head = ptable.priority_head[priority];
-      
-      // Skip to the next priority level if this one is empty
-      if (!head) continue;
-
-      p = head;
-
-      do {
-        if (p->state == RUNNABLE) {
-          // Found a RUNNABLE process; schedule it
-          found_runnable = 1;
-          ptable.priority_head[priority] = p->next;  // Rotate the queue
-          //cprintf("Scheduling process %d with priority %d\n", p->pid, p->nice);
-
-          proc = p;
-          switchuvm(p);
-          p->state = RUNNING;
-          swtch(&cpu->scheduler, p->context);
-          switchkvm();
-
-          // Clear `proc` after it runs
-          proc = 0;
-          break;
-        }
-        p = p->next;
-      } while (p != head);  // Complete a full rotation if needed
-
-      if(found_runnable) break;  // Exit priority loop if a process was scheduled
+    ptable_acquire();
+
+    if(ticks - cpu->lastbalance >= BALANCE_TICKS)
+      balance();
+
+    // Run up to NPROC picks per hold of ptable.lock.  The address
+    // space of the last process stays loaded until the lock is
+    // dropped, so a thread of the same process picked next runs
+    // without a cr3 reload.  That is safe because no sibling can
+    // free it (see exit) while we hold the lock and the process
+    // that used it is still alive.
+    found = 0;
+    loaded = 0;
+    for(n = 0; n < NPROC && (p = pick()) != 0; n++){
+      charge(p->gid, run(p, loaded));
+      loaded = p->pgdir;  // 0 if p exited; exit() switched to kpgdir
+      found = 1;
     }
-
-    // // If no RUNNABLE process was found, put the CPU in an idle state
-    // if (!found_runnable) {
-    //   //cprintf("No RUNNABLE processes found, CPU going idle\n");
-    //   release(&ptable.lock);
-    //   asm volatile("hlt");  // Halt CPU until the next interrupt
-    //   continue;  // Re-check processes after waking up
-    // }
-
-
-    #else  // Round Robin Scheduling
-
-    // Loop to find the first RUNNABLE process in Round Robin order
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->state == RUNNABLE){
-        proc = p;
-        switchuvm(p);
-        p->state = RUNNING;
-        swtch(&cpu->scheduler, p->context);
-        switchkvm();
-        proc = 0;  // Reset proc after process finishes or yields
-        break;  // Only run one process per scheduling cycle
-      }
+    if(loaded)
+      switchkvm();
+
+    // A CPU with nothing of its own to run tries to pull work over.
+    if(!found)
+      found = ncpu > 1 && balance();
+
+    ptable_release();
+
+    #if TICKSKIP
+    // If no RUNNABLE process was found, put the CPU in an idle state
+    // until the next interrupt instead of spinning on ptable.lock.
+    // Look again with interrupts off, so that work queued for us
+    // since the lock was dropped is not left waiting for a tick;
+    // ptable_release() leaves them off, since they were off at
+    // ptable_acquire().  sti takes effect only after the following
+    // instruction, so no interrupt can slip in before the hlt.
+    if(!found){
+      cli();
+      ptable_acquire();
+      found = !alone();
+      ptable_release();
+      if(!found)
+        asm volatile("sti; hlt");
     }
-
     #endif
-
-    release(&ptable.lock);
   }
 }
 
@@ -440,7 +1413,7 @@ sched(void)
 {
   int intena;
 
-  if(!holding(&ptable.lock))
+  if(!ptable_holding())
     panic("sched ptable.lock");
   if(cpu->ncli != 1)
     panic("sched locks");
@@ -456,12 +1429,53 @@ sched(void)
 
 // Give up the CPU for one scheduling round.
 void
+sched_yield(void)
+{
+  ptable_acquire();  //DOC: yieldlock
+  setstate(proc, RUNNABLE);
+  sched();
+  ptable_release();
+}
+
+// Timer tick while proc is running: preempt it.
+// An RT process is charged the tick against its budget and keeps
+// the CPU unless the budget is spent or a higher rtprio is waiting.
+// A deadline process likewise keeps it until its budget is spent or
+// a job with an earlier deadline is waiting.
+void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  proc->state = RUNNABLE;
+  struct proc *p;
+
+  if(proc->pgdir == 0)  // exiting; see exit()
+    return;
+  ptable_acquire();  //DOC: yieldlock
+  if(proc->dlperiod){
+    dlnext(proc, 1);
+    if(++proc->dlused < proc->dlruntime &&
+       (ptable.ndl == 0 || !dlbefore(ptable.dlheap[0], proc))){
+      ptable_release();
+      return;
+    }
+  } else if(proc->rtprio > 0 && rtready(proc) && ++proc->rtused < proc->rtbudget){
+    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+      if(p->state == RUNNABLE && p->rtprio > proc->rtprio && rtready(p))
+        break;
+    if(p == &ptable.proc[NPROC]){
+      ptable_release();
+      return;
+    }
+  }
+  #if TICKSKIP
+  if(alone()){
+    cpu->ntickskip++;
+    ptable_release();
+    return;
+  }
+  #endif
+  setstate(proc, RUNNABLE);
   sched();
-  release(&ptable.lock);
+  ptable_release();
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -471,7 +1485,7 @@ forkret(void)
 {
   static int first = 1;
   // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  ptable_release();
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -480,6 +1494,7 @@ forkret(void)
     first = 0;
     iinit(ROOTDEV);
     initlog(ROOTDEV);
+    tscinit();
   }
 
   // Return to "caller", actually trapret (see allocproc).
@@ -487,6 +1502,7 @@ forkret(void)
 
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
+// lk must not be ptable.lock; holders of ptable.lock use sleep1().
 void
 sleep(void *chan, struct spinlock *lk)
 {
@@ -502,24 +1518,85 @@ sleep(void *chan, struct spinlock *lk)
   // guaranteed that we won't miss any wakeup
   // (wakeup runs with ptable.lock locked),
   // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
+  ptable_acquire();  //DOC: sleeplock1
+  lockstat_release(lk);
 
+  sleep1(chan);
+
+  // Reacquire original lock.
+  ptable_release();
+  lockstat_acquire(lk);
+}
+
+// Sleep on chan.  The ptable lock must be held.
+static void
+sleep1(void *chan)
+{
   // Go to sleep.
   proc->chan = chan;
-  proc->state = SLEEPING;
+  setstate(proc, SLEEPING);
   sched();
 
   // Tidy up.
   proc->chan = 0;
+}
 
-  // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
+// Like sleep(), for a sleep lock held by process holderpid.
+// While we sleep, the holder inherits our priority if it is better
+// than its own.  acquiresleep() uses this in place of
+// sleep(lk, &lk->lk), passing lk->pid.
+void
+sleep_pi(void *chan, struct spinlock *lk, int holderpid)
+{
+  struct proc *p, *h;
+
+  if(proc == 0)
+    panic("sleep_pi");
+
+  ptable_acquire();
+  lockstat_release(lk);
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == holderpid && p != proc &&
+       p->state != UNUSED && p->state != ZOMBIE){
+      proc->pi_holder = p;
+      proc->pi_chan = chan;
+      pi_update(p);
+      break;
+    }
+  }
+
+  sleep1(chan);
+
+  // Woken by something other than pi_release (e.g. kill):
+  // take our priority back from the holder.
+  h = proc->pi_holder;
+  proc->pi_holder = 0;
+  proc->pi_chan = 0;
+  if(h)
+    pi_update(h);
+
+  ptable_release();
+  lockstat_acquire(lk);
+}
+
+// Give back the priority lent by processes waiting for the sleep
+// lock at chan, which the current process has just released.
+// releasesleep() calls this after wakeup(lk).
+void
+pi_release(void *chan)
+{
+  struct proc *p;
+
+  ptable_acquire();
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pi_holder == proc && p->pi_chan == chan){
+      p->pi_holder = 0;
+      p->pi_chan = 0;
+    }
   }
+  pi_update(proc);
+  ptable_release();
 }
 
 //PAGEBREAK!
@@ -532,16 +1609,76 @@ wakeup1(void *chan)
 
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
     if(p->state == SLEEPING && p->chan == chan)
-      p->state = RUNNABLE;
+      setstate(p, RUNNABLE);
 }
 
 // Wake up all processes sleeping on chan.
 void
 wakeup(void *chan)
 {
-  acquire(&ptable.lock);
+  ptable_acquire();
   wakeup1(chan);
-  release(&ptable.lock);
+  ptable_release();
+}
+
+// Futexes.
+// A thread blocks on a user word with futex_wait() and is woken by
+// futex_wake() on the same word.  The sleep channel is the word's
+// kernel address, i.e. its physical address, so every thread that
+// maps the word agrees on it.  The value check and the sleep happen
+// under ptable.lock, which futex_wake() also takes, so a wakeup
+// between a user's check and its futex_wait() cannot be lost.
+
+static void*
+futexchan(uint addr)
+{
+  char *ka;
+
+  if(addr % sizeof(int) != 0 || addr >= proc->sz)
+    return 0;
+  if((ka = uva2ka(proc->pgdir, (char*)addr)) == 0)
+    return 0;
+  return ka + (addr - PGROUNDDOWN(addr));
+}
+
+// Sleep until woken by futex_wake() if *addr still holds val.
+// Returns 0 when woken or if *addr had changed, -1 on a bad
+// address or if the process was killed.
+int
+futex_wait(int *addr, int val)
+{
+  void *chan;
+
+  if((chan = futexchan((uint)addr)) == 0)
+    return -1;
+  ptable_acquire();
+  if(*(volatile int*)chan == val)
+    sleep1(chan);
+  ptable_release();
+  return proc->killed ? -1 : 0;
+}
+
+// Wake up to n threads sleeping in futex_wait() on addr.
+// Returns the number woken, or -1 on a bad address.
+int
+futex_wake(int *addr, int n)
+{
+  struct proc *p;
+  void *chan;
+  int woken;
+
+  if((chan = futexchan((uint)addr)) == 0)
+    return -1;
+  woken = 0;
+  ptable_acquire();
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && woken < n; p++){
+    if(p->state == SLEEPING && p->chan == chan){
+      setstate(p, RUNNABLE);
+      woken++;
+    }
+  }
+  ptable_release();
+  return woken;
 }
 
 // Kill the process with the given pid.
@@ -552,25 +1689,87 @@ kill(int pid)
 {
   struct proc *p;
 
-  acquire(&ptable.lock);
+  ptable_acquire();
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
     if(p->pid == pid){
-      p->killed = 1;
+      // A zombie keeps the status it exited with.
+      if(p->state != ZOMBIE){
+        p->killed = 1;
+        p->xstate = -1;
+      }
       // Wake process from sleep if necessary.
       if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
+        setstate(p, RUNNABLE);
+      ptable_release();
       return 0;
     }
   }
-  release(&ptable.lock);
+  ptable_release();
   return -1;
 }
 
+// Copy p's monitored fields into *ps without taking ptable.lock.
+// Returns 0 once it gets a copy no writer touched, or -1 if a
+// writer was active for all tries attempts.
+static int
+readproc(struct proc *p, struct pstat *ps, int tries)
+{
+  struct proc *parent;
+  uint seq;
+
+  while(tries-- > 0){
+    seq = p->seq;
+    __sync_synchronize();
+    if(seq & 1)
+      continue;  // write in progress
+    ps->pid = p->pid;
+    parent = p->parent;
+    ps->ppid = parent ? parent->pid : 0;
+    ps->state = p->state;
+    ps->nice = p->nice;
+    ps->gid = p->gid;
+    ps->pgid = p->pgid;
+    ps->rtprio = p->rtprio;
+    ps->dlmiss = p->dlmiss;
+    ps->cpu = p->cpu;
+    ps->nmigrate = p->nmigrate;
+    ps->nsched = p->nsched;
+    ps->cycles = p->cycles;
+    memmove(ps->name, p->name, sizeof(ps->name));
+    __sync_synchronize();
+    if(p->seq == seq)
+      return 0;
+  }
+  return -1;
+}
+
+#define SNAPTRIES 1000  // readproc attempts before giving up or rechecking
+
+// Fill ps with up to n consistent snapshots of live processes,
+// without blocking the scheduler.  Returns the number filled.
+int
+procsnap(struct pstat *ps, int n)
+{
+  struct proc *p;
+  int count;
+
+  count = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && count < n; p++){
+    // Writers hold ptable.lock with interrupts off,
+    // so this spins for a few instructions at most.
+    while(readproc(p, &ps[count], SNAPTRIES) < 0)
+      ;
+    if(ps[count].state != UNUSED)
+      count++;
+  }
+  return count;
+}
+
 //PAGEBREAK: 36
 // Print a process listing to console.  For debugging.
 // Runs when user types ^P on console.
-// No lock to avoid wedging a stuck machine further.
+// No lock to avoid wedging a stuck machine further; fields come
+// from readproc, which gives up on a slot a writer never finishes.
 void
 procdump(void)
 {
@@ -584,19 +1783,25 @@ procdump(void)
   };
   int i;
   struct proc *p;
+  struct pstat ps;
   char *state;
   uint pc[10];
 
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->state == UNUSED)
+    if(readproc(p, &ps, SNAPTRIES) < 0){
+      cprintf("slot %d busy\n", (int)(p - ptable.proc));
       continue;
-    if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
-      state = states[p->state];
+    }
+    if(ps.state == UNUSED)
+      continue;
+    if(ps.state >= 0 && ps.state < NELEM(states) && states[ps.state])
+      state = states[ps.state];
     else
       state = "???";
+    ps.name[sizeof(ps.name)-1] = 0;
     // Print the process ID, state, name, and priority (nice value)
-    cprintf("%d %s %s priority:%d", p->pid, state, p->name, p->nice);
-    if(p->state == SLEEPING){
+    cprintf("%d %s %s priority:%d", ps.pid, state, ps.name, ps.nice);
+    if(ps.state == SLEEPING){
       getcallerpcs((uint*)p->context->ebp+2, pc);
       for(i=0; i<10 && pc[i] != 0; i++)
         cprintf(" %p", pc[i]);
@@ -605,35 +1810,130 @@ procdump(void)
   }
 }
 
+// Whether value is a nice value: loadweight() and the priority
+// queues index by it.  set_nice() and nicepg() both check with this.
+static int
+nicevalid(int value)
+{
+  return value >= 1 && value <= MAX_PRIORITY;
+}
+
 // In proc.c
 int
 set_nice(int pid, int value)
 {
   struct proc *p;
-  acquire(&ptable.lock); // Lock the process table
+
+  if(!nicevalid(value))
+    return -1;
+  ptable_acquire(); // Lock the process table
   for(p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
     if (p->pid == pid) { // Find process with the matching pid
       //cprintf("set_nice: Found process PID %d with current nice = %d\n", pid, p->nice); // Debug: Check current nice value
 
-      int old_nice = p->nice; // Store the old nice value
+      int old_nice = p->base_nice; // Store the old nice value
 
-      #if PRIORITY_SCHEDULER
-      remove_from_priority_queue(p);  // Remove the process from its current priority queue
-
-      p->nice = value; // Set the new nice value
-      
-      add_to_priority_queue(p); // Reinsert the process into the new priority queue based on updated nice value
-      #else
-      p->nice = value;
-      #endif
+      p->base_nice = value; // Set the new nice value
+      pi_update(p); // Apply it, unless a waiter lends a better one, and requeue
 
       //cprintf("set_nice: PID %d, old nice = %d, new nice = %d\n", pid, old_nice, p->nice); // Debug: Confirm the update
 
-      release(&ptable.lock); // Unlock the process table
+      ptable_release(); // Unlock the process table
       return old_nice; // Return the old nice value
     }
   }
-  release(&ptable.lock); // Unlock if pid is not found
+  ptable_release(); // Unlock if pid is not found
   //cprintf("set_nice: Process with PID %d not found\n", pid); // Debug: If process not found
   return -1; // Return -1 if the process was not found
 }
+
+// Process groups.
+// Every process belongs to a process group, named by pgid and
+// inherited across fork().  killpg() and nicepg() act on all members
+// in a single ptable.lock hold, so a job of many workers is stopped
+// or reprioritized in one scan and no member is seen half-updated.
+
+// Move process pid (0 for the caller) into process group pgid
+// (0 for a new group named by pid).  Only the caller and its
+// children may be moved.
+int
+setpgid(int pid, int pgid)
+{
+  struct proc *p;
+
+  if(pid == 0)
+    pid = proc->pid;
+  if(pgid == 0)
+    pgid = pid;
+  if(pid < 0 || pgid < 0)
+    return -1;
+  ptable_acquire();
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pid == pid && p->state != UNUSED && p->state != ZOMBIE &&
+       (p == proc || p->parent == proc)){
+      seq_begin(p);
+      p->pgid = pgid;
+      seq_end(p);
+      ptable_release();
+      return 0;
+    }
+  }
+  ptable_release();
+  return -1;
+}
+
+// Kill every process in group pgid.  Returns the number killed,
+// or -1 if the group is empty or is init's, which every process
+// starts in.
+int
+killpg(int pgid)
+{
+  struct proc *p;
+  int n;
+
+  n = 0;
+  ptable_acquire();
+  if(pgid == initproc->pgid){
+    ptable_release();
+    return -1;
+  }
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pgid != pgid || p->state == UNUSED || p->state == ZOMBIE)
+      continue;
+    p->killed = 1;
+    p->xstate = -1;
+    if(p->state == SLEEPING)
+      setstate(p, RUNNABLE);
+    n++;
+  }
+  ptable_release();
+  return n ? n : -1;
+}
+
+// Set the nice value of every process in group pgid, moving each
+// to its new priority queue.  Returns the number changed, or -1 if
+// the group is empty or init's, or value is out of range.
+int
+nicepg(int pgid, int value)
+{
+  struct proc *p;
+  int n;
+
+  if(!nicevalid(value))
+    return -1;
+  n = 0;
+  ptable_acquire();
+  if(pgid == initproc->pgid){
+    ptable_release();
+    return -1;
+  }
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p->pgid != pgid || p->state == UNUSED || p->state == ZOMBIE)
+      continue;
+    p->base_nice = value;
+    pi_update(p);  // Keeps any priority lent by a waiter
+    n++;
+  }
+  ptable_release();
+  return n ? n : -1;
+}
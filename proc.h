@@ -7,6 +7,13 @@ struct cpu {
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
+  unsigned long long busy;     // Cycles spent running processes
+  uint nsched;                 // Processes run by scheduler()
+  uint nmigrate;               // Processes pulled over by balance()
+  uint lastbalance;            // Tick of the last balance()
+  uint ntickskip;              // Timer ticks that did not preempt (TICKSKIP)
+  uint nsamevm;                // Switches between threads that kept cr3
+  int rr;                      // Round robin: index of the last proc picked
 
   // Cpu-local storage variables; see below
   struct cpu *cpu;
@@ -48,6 +55,22 @@ struct context {
 
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+#define MAX_PRIORITY 5  // Nice values run from 1 (highest) to MAX_PRIORITY
+
+#define NVMA      4     // File mappings per process
+#define VMAPAGES  1024  // Pages in the largest mapping
+
+// A file mapped with mmap(); pages are read in on first touch
+// (see mmap.c).
+struct vma {
+  struct file *f;              // Mapped file, 0 if the slot is free
+  uint addr;                   // Start, page-aligned
+  uint len;                    // Length, a multiple of PGSIZE
+  uint off;                    // File offset of addr, page-aligned
+  int prot;                    // PROT_READ, PROT_WRITE (mmap.h)
+  uchar resident[VMAPAGES/8];  // Pages faulted in so far
+};
+
 // Per-process state
 struct proc {
   uint sz;                     // Size of process memory (bytes)
@@ -64,6 +87,35 @@ struct proc {
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
   int nice;                     // Added the nice field for priority
+  int base_nice;               // nice set by the user; nice may be lower while lent
+  struct proc *pi_holder;      // Holder of the sleep lock we wait for (sleep_pi)
+  void *pi_chan;               // That sleep lock
+  int gid;                     // Scheduling group (see pickgroup in proc.c)
+  int rtprio;                  // Real-time priority, 0 if not real-time (see pickrt)
+  uint rtbudget;               // RT: ticks it may run per period
+  uint rtperiod;               // RT: period length in ticks
+  uint rtstart;                // RT: tick the current period began
+  uint rtused;                 // RT: ticks run in the current period
+  uint rtstamp;                // When it last became RUNNABLE (FIFO order)
+  uint dlruntime;              // Deadline: ticks reserved per period, 0 if none
+  uint dlperiod;               // Deadline: period in ticks, 0 if not a deadline process
+  uint dldeadline;             // Deadline: absolute deadline (tick) of the current job
+  uint dlused;                 // Deadline: ticks run by the current job
+  uint dlmiss;                 // Deadline: jobs that missed their deadline
+  int dlidx;                   // Slot in ptable.dlheap, -1 if not there
+  int cpu;                     // CPU whose scheduler runs it (see balance in proc.c)
+  uint nmigrate;               // Times moved to another CPU by balance()
+  int thread;                  // Created by clone(); shares its parent's pgdir
+  void *ustack;                // Thread: user stack passed to clone()
+  int xstate;                  // Exit status for waitn(); -1 if killed
+  int pgid;                    // Process group (killpg, nicepg)
+  struct vma vma[NVMA];        // Mapped files (mmap.c)
+  int vmabusy;                 // A fault or exit is using vma[] (mmap.c)
+  struct proc *next;           // Next in priority queue (PRIORITY_SCHEDULER)
+  struct proc *prev;           // Previous in priority queue
+  uint nsched;                 // Times picked by scheduler()
+  unsigned long long cycles;   // CPU time in rdtsc cycles
+  uint seq;                    // Odd while monitored fields change; see readproc()
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -0,0 +1,109 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "prof.h"
+
+// Run a command under the sampling profiler and print a histogram
+// of the sampled program counters, most frequent first:
+//   prof cmd=NAME pid=P samples=S user=U kernel=K dropped=D
+//   prof u|k EIP COUNT
+// Feed the output to profsym.pl on the host to see function names.
+//
+// Usage: prof [-d div] [-n top] cmd args...
+//   div: sample every div'th timer tick (default 1)
+
+#define NPC 512  // distinct PCs kept
+
+static struct profsample buf[256];
+static struct {
+  uint eip;
+  int user;
+  int count;
+} pcs[NPC];
+static int npcs, other;
+
+static void
+add(struct profsample *s)
+{
+  int i;
+
+  for(i = 0; i < npcs; i++)
+    if(pcs[i].eip == s->eip && pcs[i].user == s->user){
+      pcs[i].count++;
+      return;
+    }
+  if(npcs == NPC){
+    other++;
+    return;
+  }
+  pcs[npcs].eip = s->eip;
+  pcs[npcs].user = s->user;
+  pcs[npcs].count = 1;
+  npcs++;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, j, n, pid, div = 1, top = 20, fd[2], dropped;
+  int total, user;
+  char c;
+
+  for(i = 1; i + 1 < argc && argv[i][0] == '-'; i += 2){
+    if(strcmp(argv[i], "-d") == 0)
+      div = atoi(argv[i+1]);
+    else if(strcmp(argv[i], "-n") == 0)
+      top = atoi(argv[i+1]);
+    else
+      break;
+  }
+  if(i >= argc || argv[i][0] == '-' || div < 1){
+    printf(2, "usage: prof [-d div] [-n top] cmd args...\n");
+    exit();
+  }
+
+  // The child waits until profiling is on for its pid.
+  pipe(fd);
+  if((pid = fork()) == 0){
+    close(fd[1]);
+    read(fd[0], &c, 1);
+    close(fd[0]);
+    exec(argv[i], argv + i);
+    printf(2, "prof: exec %s failed\n", argv[i]);
+    exit();
+  }
+  close(fd[0]);
+  if(profctl(pid, div) < 0){
+    printf(2, "prof: profctl failed\n");
+    kill(pid);
+  }
+  write(fd[1], "x", 1);
+  close(fd[1]);
+  wait();
+  dropped = profctl(0, 0);
+
+  total = user = 0;
+  while((n = profread(buf, sizeof(buf)/sizeof(buf[0]))) > 0){
+    for(j = 0; j < n; j++){
+      if(buf[j].pid != pid)
+        continue;
+      total++;
+      user += buf[j].user;
+      add(&buf[j]);
+    }
+  }
+
+  printf(1, "prof cmd=%s pid=%d samples=%d user=%d kernel=%d dropped=%d\n",
+         argv[i], pid, total, user, total - user, dropped + other);
+  while(top-- > 0){
+    n = -1;
+    for(j = 0; j < npcs; j++)
+      if(pcs[j].count > 0 && (n < 0 || pcs[j].count > pcs[n].count))
+        n = j;
+    if(n < 0)
+      break;
+    printf(1, "prof %s %x %d\n", pcs[n].user ? "u" : "k", pcs[n].eip, pcs[n].count);
+    pcs[n].count = 0;
+  }
+  exit();
+}
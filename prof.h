@@ -0,0 +1,17 @@
+// Sampling profiler.
+
+#define NPROFBUF 4096  // samples buffered per CPU
+
+// One timer-tick sample, as returned by profread().
+struct profsample {
+  uint eip;          // Interrupted instruction
+  int pid;           // Running process, 0 if the CPU was idle
+  int user;          // 1 if the CPU was in user mode
+};
+
+// profile.c
+struct trapframe;
+void profinit(void);
+void profintr(struct trapframe*);
+int profctl(int, int);
+int profread(struct profsample*, int);
@@ -0,0 +1,122 @@
+// Sampling profiler.
+//
+// trap() calls profintr() on every timer interrupt.  While profiling
+// is on, every div'th tick each CPU records the interrupted EIP, the
+// running pid and whether it was in user mode into its own buffer.
+// profread() drains the buffers; the prof program aggregates the
+// samples and profsym.pl maps them to symbols using the .sym files
+// the Makefile writes for the kernel and every user program.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "x86.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "prof.h"
+
+// Each CPU fills its own buffer under its own lock, so the timer
+// interrupt never contends with other CPUs; prof.lock only orders
+// profctl() and profread() against each other.
+static struct {
+  struct spinlock lock;
+  int pid;                // Process to sample, 0 for everything
+  int div;                // Sample every div'th tick; 0 when off
+  struct {
+    struct spinlock lock;
+    uint tick;            // Ticks seen on this CPU while on
+    uint dropped;         // Samples lost to a full buf
+    int n;                // Samples in buf
+    struct profsample buf[NPROFBUF];
+  } cpu[NCPU];
+} prof;
+
+void
+profinit(void)
+{
+  int c;
+
+  initlock(&prof.lock, "prof");
+  for(c = 0; c < NCPU; c++)
+    initlock(&prof.cpu[c].lock, "profcpu");
+}
+
+void
+profintr(struct trapframe *tf)
+{
+  struct profsample *s;
+  int c, div, pid;
+
+  if((div = prof.div) == 0)
+    return;
+  pid = prof.pid;
+  c = cpu - cpus;
+  acquire(&prof.cpu[c].lock);
+  if(++prof.cpu[c].tick % div == 0 &&
+     (pid == 0 || (proc && proc->pid == pid))){
+    if(prof.cpu[c].n == NPROFBUF)
+      prof.cpu[c].dropped++;
+    else {
+      s = &prof.cpu[c].buf[prof.cpu[c].n++];
+      s->eip = tf->eip;
+      s->pid = proc ? proc->pid : 0;
+      s->user = (tf->cs & 3) == DPL_USER;
+    }
+  }
+  release(&prof.cpu[c].lock);
+}
+
+// Start sampling pid (0: everything) every div ticks,
+// or stop if div is 0.  Starting discards old samples.
+// Returns the samples dropped since the last start.
+int
+profctl(int pid, int div)
+{
+  int c, dropped;
+
+  if(div < 0)
+    return -1;
+  acquire(&prof.lock);
+  // Stop sampling before switching pid, so that no tick samples
+  // the new pid at the old rate or the old pid at the new one.
+  prof.div = 0;
+  dropped = 0;
+  for(c = 0; c < NCPU; c++){
+    acquire(&prof.cpu[c].lock);
+    dropped += prof.cpu[c].dropped;
+    if(div > 0){
+      prof.cpu[c].n = 0;
+      prof.cpu[c].tick = 0;
+      prof.cpu[c].dropped = 0;
+    }
+    release(&prof.cpu[c].lock);
+  }
+  prof.pid = pid;
+  prof.div = div;
+  release(&prof.lock);
+  return dropped;
+}
+
+// Move up to n buffered samples into buf.  Returns the count.
+int
+profread(struct profsample *buf, int n)
+{
+  int c, k, got;
+
+  got = 0;
+  acquire(&prof.lock);
+  for(c = 0; c < NCPU && got < n; c++){
+    acquire(&prof.cpu[c].lock);
+    k = prof.cpu[c].n;
+    if(k > n - got)
+      k = n - got;
+    prof.cpu[c].n -= k;
+    memmove(buf + got, prof.cpu[c].buf + prof.cpu[c].n, k * sizeof(*buf));
+    release(&prof.cpu[c].lock);
+    got += k;
+  }
+  release(&prof.lock);
+  return got;
+}
@@ -0,0 +1,56 @@
+#!/usr/bin/perl -w
+
+# Symbolize the output of the prof program.
+# Reads prof lines (e.g. a saved console log), maps each sampled PC
+# to the function containing it using kernel.sym and CMD.sym, which
+# the Makefile writes next to the kernel and every user program, and
+# prints samples per function, most frequent first.
+#
+# Usage: ./profsym.pl [log]
+
+use strict;
+
+my %syms;  # mode -> sorted list of [addr, name]
+
+sub loadsym {
+    my ($file) = @_;
+    my @s;
+    open(my $fh, '<', $file) or die "profsym: $file: $!\n";
+    while(<$fh>){
+        push @s, [hex($1), $2] if /^([0-9a-f]+)\s+(\S+)/;
+    }
+    close($fh);
+    return [sort { $a->[0] <=> $b->[0] } @s];
+}
+
+# Name of the function containing addr: the last symbol at or below it.
+sub lookup {
+    my ($s, $addr) = @_;
+    my ($lo, $hi) = (0, $#$s);
+    return sprintf("0x%x", $addr) if $hi < 0 || $s->[0][0] > $addr;
+    while($lo < $hi){
+        my $mid = int(($lo + $hi + 1) / 2);
+        if($s->[$mid][0] <= $addr){ $lo = $mid; } else { $hi = $mid - 1; }
+    }
+    return $s->[$lo][1];
+}
+
+my (%count, $total, $header);
+while(<>){
+    if(/^prof cmd=(\S+)/){
+        $header = $_;
+        $syms{k} = loadsym("kernel.sym");
+        $syms{u} = -e "$1.sym" ? loadsym("$1.sym") : [];
+        %count = ();
+        $total = 0;
+    } elsif(/^prof ([uk]) ([0-9a-f]+) (\d+)/ && defined $header){
+        $count{"$1 " . lookup($syms{$1}, hex($2))} += $3;
+        $total += $3;
+    }
+}
+die "profsym: no prof output found\n" unless defined $header;
+
+print $header;
+foreach my $f (sort { $count{$b} <=> $count{$a} } keys %count){
+    printf("%6d %5.1f%%  %s\n", $count{$f}, 100 * $count{$f} / $total, $f);
+}
@@ -0,0 +1,30 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "pstat.h"
+
+// List processes from a procsnap() snapshot.
+// The snapshot is taken without ptable.lock, so polling it
+// does not hold up scheduler() on other CPUs.
+
+static char *states[] = {
+  "unused", "embryo", "sleep", "runble", "run", "zombie"
+};
+
+static struct pstat ps[NPROC];
+
+int
+main(void)
+{
+  int i, n;
+
+  n = procsnap(ps, NPROC);
+  printf(1, "pid ppid state nice rt gid pgid cpu nsched kcycles name\n");
+  for(i = 0; i < n; i++)
+    printf(1, "%d %d %s %d %d %d %d %d %d %d %s\n", ps[i].pid, ps[i].ppid,
+           ps[i].state >= 0 && ps[i].state < sizeof(states)/sizeof(states[0]) ?
+           states[ps[i].state] : "???",
+           ps[i].nice, ps[i].rtprio, ps[i].gid, ps[i].pgid, ps[i].cpu, ps[i].nsched, (uint)(ps[i].cycles >> 10), ps[i].name);
+  exit();
+}
@@ -0,0 +1,34 @@
+// Consistent snapshot of one process, as returned by procsnap().
+struct pstat {
+  int pid;
+  int ppid;          // Parent's pid, 0 if none
+  int state;         // enum procstate (proc.h)
+  int nice;
+  int gid;           // Scheduling group
+  int pgid;          // Process group
+  int rtprio;        // Real-time priority, 0 if none
+  uint dlmiss;       // Deadline misses (deadline())
+  int cpu;           // CPU it belongs to
+  uint nmigrate;     // Times moved between CPUs
+  uint nsched;       // Times picked by scheduler()
+  unsigned long long cycles;  // CPU time in rdtsc cycles
+  char name[16];
+};
+
+// Values of pstat.state, in the order of enum procstate (proc.h).
+#define PS_UNUSED   0
+#define PS_EMBRYO   1
+#define PS_SLEEPING 2
+#define PS_RUNNABLE 3
+#define PS_RUNNING  4
+#define PS_ZOMBIE   5
+
+// Per-CPU statistics, as returned by cpustat().
+struct cpustat {
+  unsigned long long busy;  // Time spent running processes, in ns
+  uint nsched;       // Processes run
+  uint nmigrate;     // Processes pulled over from other CPUs
+  int load;          // Current weighted load (see balance in proc.c)
+  uint ntickskip;    // Timer ticks that left a lone process running
+  uint nsamevm;      // Switches between threads that kept cr3
+};
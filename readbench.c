@@ -0,0 +1,131 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "div64.h"
+#include "fcntl.h"
+
+// File read throughput through the buffer cache.
+//   readbench seq ...     one process reads each of nfile files front
+//                         to back, rounds times
+//   readbench par ...     nfile processes each do the same with their
+//                         own file at once, on as many CPUs as there are
+//   readbench shared ...  nfile processes all read the first file
+// Files are kb kilobytes (at most 70, the largest xv6 file) and are
+// read in 512-byte blocks.  Prints blocks=B ms=T blocks_per_sec=R.
+//
+// Usage: readbench [nfile [kb [rounds]]]
+
+#define BLOCK 512
+
+static char buf[BLOCK];
+static int nblock;  // Blocks per file
+
+static void
+name(char *s, int i)
+{
+  strcpy(s, "readbench.0");
+  s[10] = '0' + i;
+}
+
+// Read file i front to back; returns the number of blocks read.
+static int
+readfile(int i)
+{
+  char path[16];
+  int fd, n;
+
+  name(path, i);
+  if((fd = open(path, O_RDONLY)) < 0){
+    printf(2, "readbench: cannot open %s\n", path);
+    exit();
+  }
+  for(n = 0; read(fd, buf, BLOCK) == BLOCK; n++)
+    ;
+  close(fd);
+  return n;
+}
+
+static void
+report(char *mode, int nfile, int blocks, unsigned long long t)
+{
+  uint ms;
+
+  ms = (uint)div64(t, 1000000, 0);
+  if(ms == 0)
+    ms = 1;
+  printf(1, "readbench %s files=%d blocks=%d ms=%d blocks_per_sec=%d\n",
+         mode, nfile, blocks, ms, blocks * 1000 / ms);
+}
+
+// nproc readers at once; reader j reads file (shared ? 0 : j).
+static void
+parallel(char *mode, int nproc, int rounds, int shared)
+{
+  int j, r;
+  unsigned long long t0;
+
+  t0 = nsnow();
+  for(j = 0; j < nproc; j++){
+    if(fork() == 0){
+      for(r = 0; r < rounds; r++)
+        readfile(shared ? 0 : j);
+      exit();
+    }
+  }
+  for(j = 0; j < nproc; j++)
+    wait();
+  report(mode, nproc, nproc * rounds * nblock, nsnow() - t0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nfile = 4, kb = 32, rounds = 4;
+  int i, j, fd, r, blocks;
+  char path[16];
+  unsigned long long t0;
+
+  if(argc > 1)
+    nfile = atoi(argv[1]);
+  if(argc > 2)
+    kb = atoi(argv[2]);
+  if(argc > 3)
+    rounds = atoi(argv[3]);
+  if(nfile < 1 || nfile > 10)
+    nfile = 4;
+  if(kb < 1 || kb > 70)
+    kb = 32;
+
+  nblock = kb * 1024 / BLOCK;
+  memset(buf, 'x', BLOCK);
+  for(i = 0; i < nfile; i++){
+    name(path, i);
+    if((fd = open(path, O_CREATE | O_RDWR)) < 0){
+      printf(2, "readbench: cannot create %s\n", path);
+      exit();
+    }
+    for(j = 0; j < nblock; j++){
+      if(write(fd, buf, BLOCK) != BLOCK){
+        printf(2, "readbench: file system full, try fewer or smaller files\n");
+        exit();
+      }
+    }
+    close(fd);
+  }
+
+  blocks = 0;
+  t0 = nsnow();
+  for(r = 0; r < rounds; r++)
+    for(i = 0; i < nfile; i++)
+      blocks += readfile(i);
+  report("seq", nfile, blocks, nsnow() - t0);
+
+  parallel("par", nfile, rounds, 0);
+  parallel("shared", nfile, rounds, 1);
+
+  for(i = 0; i < nfile; i++){
+    name(path, i);
+    unlink(path);
+  }
+  exit();
+}
@@ -0,0 +1,46 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+#include "sysring.h"
+
+// Compare the per-call cost of trapping for every system call with
+// queueing the same calls in a sysring and submitting them in batches.
+//
+// Usage: ringbench [calls] [batch]
+
+static struct sysring ring;
+
+int
+main(int argc, char *argv[])
+{
+  int calls = 200000, batch = SYSRING_SIZE;
+  int i, j, pid, t0, trap, batched;
+
+  if(argc > 1)
+    calls = atoi(argv[1]);
+  if(argc > 2)
+    batch = atoi(argv[2]);
+  if(batch < 1 || batch > SYSRING_SIZE)
+    batch = SYSRING_SIZE;
+  pid = getpid();
+
+  t0 = uptime();
+  for(i = 0; i < calls; i++)
+    nice(pid, 3);
+  trap = uptime() - t0;
+
+  ringinit(&ring);
+  t0 = uptime();
+  for(i = 0; i < calls; i += batch){
+    for(j = 0; j < batch && i + j < calls; j++)
+      ringpush(&ring, SYS_nice, pid, 3, 0);
+    if(ringsubmit(&ring) != j)
+      printf(2, "ringbench: short batch\n");
+  }
+  batched = uptime() - t0;
+
+  printf(1, "ringbench calls=%d batch=%d trap_ticks=%d ring_ticks=%d\n",
+         calls, batch, trap, batched);
+  exit();
+}
@@ -0,0 +1,84 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Real-time wake-to-run latency under load.
+// One CPU-bound hog per nice level 1..5 runs while a reader blocked
+// on a pipe is woken n times; each wakeup's latency is the time from
+// the write until the reader runs.  The test runs once with the
+// reader in the normal class and once admitted to the RT class.
+//
+// Usage: rtbench [n]
+
+#define NSAMPLE 200
+
+static int samples[NSAMPLE];
+
+// Measure n wakeups of a reader, admitted to the RT class if rt.
+static void
+latency(int n, int rt)
+{
+  int fd[2], res[2], hog[5], i, got, lat, pid;
+  unsigned long long t;
+
+  for(i = 0; i < 5; i++){
+    if((hog[i] = fork()) == 0){
+      nice(getpid(), i + 1);
+      for(;;)
+        ;
+    }
+  }
+
+  pipe(fd);
+  pipe(res);
+  if((pid = fork()) == 0){
+    close(fd[1]);
+    close(res[0]);
+    while(read(fd[0], &t, sizeof(t)) == sizeof(t)){
+      lat = nsnow() - t;
+      write(res[1], &lat, sizeof(lat));
+    }
+    exit();
+  }
+  close(fd[0]);
+  close(res[1]);
+  if(rt && rtsched(pid, 10, 2, 10) < 0)
+    printf(2, "rtbench: rtsched failed\n");
+
+  for(got = 0; got < n; got++){
+    sleep(1);  // let the reader block in read() first
+    t = nsnow();
+    write(fd[1], &t, sizeof(t));
+    if(read(res[0], &samples[got], sizeof(samples[got])) != sizeof(samples[got]))
+      break;
+  }
+  close(fd[1]);
+  close(res[0]);
+  wait();
+  for(i = 0; i < 5; i++){
+    kill(hog[i]);
+    wait();
+  }
+
+  n = got;
+  if(n == 0)
+    return;
+  sort(samples, n);
+  printf(1, "rtbench rt=%d hogs=5 n=%d p50=%d p90=%d p99=%d max=%d unit=ns\n",
+         rt, n, samples[n*50/100], samples[n*90/100], samples[n*99/100],
+         samples[n-1]);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = 100;
+
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(n > NSAMPLE)
+    n = NSAMPLE;
+  latency(n, 0);
+  latency(n, 1);
+  exit();
+}
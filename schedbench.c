@@ -0,0 +1,258 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+// Scheduler benchmarks.  Each subcommand prints exactly one line
+//   schedbench <test> key=value ...
+// so results can be collected by a script (see schedbench.sh).
+// Latencies are in nanoseconds (unit=ns).
+//
+// Usage: schedbench all | fork | yield | pipe | wakeup | fair | starve
+
+#define NSAMPLE 1000
+
+static int samples[NSAMPLE];
+
+// Print p50/p90/p99/max of the first n samples.
+static void
+percentiles(int n)
+{
+  sort(samples, n);
+  printf(1, " p50=%d p90=%d p99=%d max=%d unit=ns\n",
+         samples[n*50/100], samples[n*90/100], samples[n*99/100],
+         samples[n-1]);
+}
+
+// Wait for tick t so that competing children start together.
+static void
+waituntil(int t)
+{
+  while(uptime() < t)
+    ;
+}
+
+// fork/exit throughput: fork a child that exits at once, reap it.
+static void
+forkbench(int n)
+{
+  int i, t0, t;
+
+  t0 = uptime();
+  for(i = 0; i < n; i++){
+    if(fork() == 0)
+      exit();
+    wait();
+  }
+  t = uptime() - t0;
+  printf(1, "schedbench fork n=%d ticks=%d per_tick=%d\n",
+         n, t, t ? n / t : n);
+}
+
+// Two processes yield back and forth for a fixed number of ticks.
+static void
+yieldbench(int ticks)
+{
+  int fd[2], i, n, total, start;
+
+  pipe(fd);
+  start = uptime() + 2;
+  for(i = 0; i < 2; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      waituntil(start);
+      for(n = 0; uptime() < start + ticks; n++)
+        yield();
+      write(fd[1], &n, sizeof(n));
+      exit();
+    }
+  }
+  close(fd[1]);
+  total = 0;
+  for(i = 0; i < 2; i++){
+    if(read(fd[0], &n, sizeof(n)) == sizeof(n))
+      total += n;
+    wait();
+  }
+  close(fd[0]);
+  printf(1, "schedbench yield procs=2 ticks=%d yields=%d per_tick=%d\n",
+         ticks, total, total / ticks);
+}
+
+// Round trip of one byte through a pair of pipes.
+static void
+pipebench(int n)
+{
+  int ping[2], pong[2], i;
+  unsigned long long t0;
+  char c;
+
+  if(n > NSAMPLE)
+    n = NSAMPLE;
+  pipe(ping);
+  pipe(pong);
+  if(fork() == 0){
+    close(ping[1]);
+    close(pong[0]);
+    while(read(ping[0], &c, 1) == 1)
+      write(pong[1], &c, 1);
+    exit();
+  }
+  close(ping[0]);
+  close(pong[1]);
+  for(i = 0; i < n; i++){
+    t0 = nsnow();
+    write(ping[1], "x", 1);
+    read(pong[0], &c, 1);
+    samples[i] = nsnow() - t0;
+  }
+  close(ping[1]);
+  close(pong[0]);
+  wait();
+  printf(1, "schedbench pipe n=%d", n);
+  percentiles(n);
+}
+
+// Time from a write to a blocked reader until that reader runs.
+static void
+wakeupbench(int n)
+{
+  int fd[2], res[2], i, lat;
+  unsigned long long t;
+
+  if(n > NSAMPLE)
+    n = NSAMPLE;
+  pipe(fd);
+  pipe(res);
+  if(fork() == 0){
+    close(fd[1]);
+    close(res[0]);
+    while(read(fd[0], &t, sizeof(t)) == sizeof(t)){
+      lat = nsnow() - t;
+      write(res[1], &lat, sizeof(lat));
+    }
+    exit();
+  }
+  close(fd[0]);
+  close(res[1]);
+  for(i = 0; i < n; i++){
+    sleep(1);  // let the child block in read() first
+    t = nsnow();
+    write(fd[1], &t, sizeof(t));
+    if(read(res[0], &samples[i], sizeof(samples[i])) != sizeof(samples[i]))
+      break;
+  }
+  close(fd[1]);
+  close(res[0]);
+  wait();
+  if(i == 0)
+    return;
+  printf(1, "schedbench wakeup n=%d", i);
+  percentiles(i);
+}
+
+// One CPU-bound spinner per nice level 1..5 for a fixed number of
+// ticks; prints the work each one got.
+static void
+fairbench(int ticks)
+{
+  int fd[2], i, start, rec[2], work[6];
+  volatile int n;
+
+  pipe(fd);
+  start = uptime() + 2;
+  for(i = 1; i <= 5; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      nice(getpid(), i);
+      waituntil(start);
+      for(n = 0; uptime() < start + ticks; n++)
+        ;
+      rec[0] = i;
+      rec[1] = n;
+      write(fd[1], rec, sizeof(rec));  // one write: children share the pipe
+      exit();
+    }
+  }
+  close(fd[1]);
+  for(i = 1; i <= 5; i++)
+    work[i] = 0;
+  for(i = 1; i <= 5; i++)
+    if(read(fd[0], rec, sizeof(rec)) == sizeof(rec) &&
+       rec[0] >= 1 && rec[0] <= 5)
+      work[rec[0]] = rec[1];
+  for(i = 1; i <= 5; i++)
+    wait();
+  close(fd[0]);
+  printf(1, "schedbench fair ticks=%d nice1=%d nice2=%d nice3=%d nice4=%d nice5=%d\n",
+         ticks, work[1], work[2], work[3], work[4], work[5]);
+}
+
+// A nice 5 process competes with nhog nice 1 spinners.
+// starved=1 if it made no progress in the whole run.
+static void
+starvebench(int nhog, int ticks)
+{
+  int fd[2], i, start, progress;
+  volatile int n;
+
+  pipe(fd);
+  start = uptime() + 2;
+  for(i = 0; i < nhog; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      close(fd[1]);
+      nice(getpid(), 1);
+      waituntil(start);
+      while(uptime() < start + ticks)
+        ;
+      exit();
+    }
+  }
+  if(fork() == 0){
+    close(fd[0]);
+    nice(getpid(), 5);
+    // Progress is counted only inside the contended window;
+    // the hogs stop at start+ticks.
+    for(n = 0; uptime() < start + ticks; )
+      if(uptime() >= start)
+        n++;
+    i = n;
+    write(fd[1], &i, sizeof(i));
+    exit();
+  }
+  close(fd[1]);
+  if(read(fd[0], &progress, sizeof(progress)) != sizeof(progress))
+    progress = 0;
+  for(i = 0; i < nhog + 1; i++)
+    wait();
+  close(fd[0]);
+  printf(1, "schedbench starve hogs=%d ticks=%d progress=%d starved=%d\n",
+         nhog, ticks, progress, progress == 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  char *t;
+  int all;
+
+  if(argc < 2){
+    printf(2, "usage: schedbench all|fork|yield|pipe|wakeup|fair|starve\n");
+    exit();
+  }
+  t = argv[1];
+  all = strcmp(t, "all") == 0;
+  if(all || strcmp(t, "fork") == 0)
+    forkbench(500);
+  if(all || strcmp(t, "yield") == 0)
+    yieldbench(100);
+  if(all || strcmp(t, "pipe") == 0)
+    pipebench(NSAMPLE);
+  if(all || strcmp(t, "wakeup") == 0)
+    wakeupbench(100);
+  if(all || strcmp(t, "fair") == 0)
+    fairbench(200);
+  if(all || strcmp(t, "starve") == 0)
+    starvebench(4, 200);
+  exit();
+}
@@ -0,0 +1,9 @@
+#!/bin/sh
+# Collect a scheduler regression baseline: boot xv6 with CPUS=1, 2
+# and 4 (or the counts given), run "schedbench all" in each, and
+# print every result line prefixed with cpus=N.
+#
+# Usage: ./schedbench.sh [cpus ...] > baseline.txt
+
+[ $# -gt 0 ] || set -- 1 2 4
+WAIT=${WAIT:-60} exec "$(dirname "$0")/benchsmp.sh" "schedbench all" "$@"
@@ -0,0 +1,71 @@
+// Sleeping locks
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+
+// proc.c: priority inheritance (see pi_update)
+void sleep_pi(void*, struct spinlock*, int);
+void pi_release(void*);
+
+void
+initsleeplock(struct sleeplock *lk, char *name)
+{
+  initlock(&lk->lk, "sleep lock");
+  lk->name = name;
+  lk->locked = 0;
+  lk->nwait = 0;
+  lk->pid = 0;
+}
+
+// While we wait, the holder runs at our priority if that is
+// better than its own.
+void
+acquiresleep(struct sleeplock *lk)
+{
+  acquire(&lk->lk);
+  while (lk->locked) {
+    lk->nwait++;
+    sleep_pi(lk, &lk->lk, lk->pid);
+    lk->nwait--;
+  }
+  lk->locked = 1;
+  lk->pid = proc->pid;
+  release(&lk->lk);
+}
+
+// Wake the waiters and give back any priority they lent us.
+// Without waiters, and unboosted, there is nothing to give back,
+// and the common case stays off ptable.lock.
+void
+releasesleep(struct sleeplock *lk)
+{
+  int nwait;
+
+  acquire(&lk->lk);
+  lk->locked = 0;
+  lk->pid = 0;
+  nwait = lk->nwait;
+  if(nwait)
+    wakeup(lk);
+  release(&lk->lk);
+  if(nwait || proc->nice != proc->base_nice)
+    pi_release(lk);
+}
+
+int
+holdingsleep(struct sleeplock *lk)
+{
+  int r;
+
+  acquire(&lk->lk);
+  r = lk->locked;
+  release(&lk->lk);
+  return r;
+}
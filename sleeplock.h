@@ -0,0 +1,11 @@
+// Long-term locks for processes
+struct sleeplock {
+  uint locked;       // Is the lock held?
+  struct spinlock lk; // spinlock protecting this sleep lock
+  int nwait;         // Processes blocked in acquiresleep()
+
+  // For debugging:
+  char *name;        // Name of lock.
+  int pid;           // Process holding lock
+};
+
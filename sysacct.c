@@ -0,0 +1,80 @@
+// System call accounting.
+//
+// syscall() times every call with rdtsc and hands the number and
+// latency to sysstat_record(), which counts it and adds it to a log2
+// histogram.  Each CPU has its own table, updated with interrupts
+// off so that no lock is needed; sysstat_read() sums the tables.
+// Accounting can be limited to one process.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "sysstat.h"
+
+#if SYSSTAT
+
+static struct sysstat stats[NCPU][NSYSCALL];
+static int watchpid;  // if non-zero, only account for this pid
+
+// Histogram bucket for a latency of c cycles: floor(log2(c)).
+static int
+bucket(unsigned long long c)
+{
+  uint hi, lo;
+
+  hi = c >> 32;
+  lo = c;
+  if(hi)
+    return NSYSHIST - 1;
+  if(lo == 0)
+    return 0;
+  return 31 - __builtin_clz(lo);
+}
+
+void
+sysstat_record(int num, unsigned long long cycles)
+{
+  struct sysstat *st;
+
+  if(num < 0 || num >= NSYSCALL || (watchpid && proc->pid != watchpid))
+    return;
+  pushcli();
+  st = &stats[cpu - cpus][num];
+  st->count++;
+  st->cycles += cycles;
+  st->hist[bucket(cycles)]++;
+  popcli();
+}
+
+// Copy the statistics of system calls 0..n-1, summed over CPUs,
+// into st and optionally reset them.  If pid is not negative,
+// account only for that process from now on (0: all processes).
+// Returns the number of entries copied.  Other CPUs keep counting
+// while we read, so a sum may be slightly out of date.
+int
+sysstat_read(struct sysstat *st, int n, int reset, int pid)
+{
+  int c, i, j;
+
+  if(n > NSYSCALL)
+    n = NSYSCALL;
+  memset(st, 0, n * sizeof(*st));
+  for(c = 0; c < ncpu; c++){
+    for(i = 0; i < n; i++){
+      st[i].count += stats[c][i].count;
+      st[i].cycles += stats[c][i].cycles;
+      for(j = 0; j < NSYSHIST; j++)
+        st[i].hist[j] += stats[c][i].hist[j];
+    }
+  }
+  if(reset)
+    memset(stats, 0, sizeof(stats));
+  if(pid >= 0)
+    watchpid = pid;
+  return n;
+}
+
+#endif
@@ -7,6 +7,9 @@
 #include "x86.h"
 #include "syscall.h"
 #include "spinlock.h"
+#include "sysring.h"
+#include "sysstat.h"
+#include "tsc.h"
 
 
 
@@ -102,6 +105,33 @@ extern int sys_wait(void);
 extern int sys_write(void);
 extern int sys_uptime(void);
 extern int sys_nice(void);
+extern int sys_sysring(void);
+extern int sys_lockstat(void);
+extern int sys_yield(void);
+extern int sys_procsnap(void);
+extern int sys_clock_cycles(void);
+extern int sys_nanouptime(void);
+extern int sys_grpcreate(void);
+extern int sys_grpjoin(void);
+extern int sys_rtsched(void);
+extern int sys_deadline(void);
+extern int sys_cpustat(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_futex_wait(void);
+extern int sys_futex_wake(void);
+extern int sys_sysstat(void);
+extern int sys_profctl(void);
+extern int sys_profread(void);
+extern int sys_exitstatus(void);
+extern int sys_waitn(void);
+extern int sys_setpgid(void);
+extern int sys_killpg(void);
+extern int sys_nicepg(void);
+extern int sys_logstat(void);
+extern int sys_mmap(void);
+extern int sys_munmap(void);
+extern int sys_pipesize(void);
 
 static int (*syscalls[])(void) = {
 [SYS_fork]    sys_fork,
@@ -126,8 +156,52 @@ static int (*syscalls[])(void) = {
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
 [SYS_nice]    sys_nice,
+[SYS_sysring] sys_sysring,
+[SYS_lockstat] sys_lockstat,
+[SYS_yield]   sys_yield,
+[SYS_procsnap] sys_procsnap,
+[SYS_clock_cycles] sys_clock_cycles,
+[SYS_nanouptime] sys_nanouptime,
+[SYS_grpcreate] sys_grpcreate,
+[SYS_grpjoin] sys_grpjoin,
+[SYS_rtsched] sys_rtsched,
+[SYS_deadline] sys_deadline,
+[SYS_cpustat] sys_cpustat,
+[SYS_clone]   sys_clone,
+[SYS_join]    sys_join,
+[SYS_futex_wait] sys_futex_wait,
+[SYS_futex_wake] sys_futex_wake,
+[SYS_sysstat] sys_sysstat,
+[SYS_profctl] sys_profctl,
+[SYS_profread] sys_profread,
+[SYS_exitstatus] sys_exitstatus,
+[SYS_waitn]   sys_waitn,
+[SYS_setpgid] sys_setpgid,
+[SYS_killpg]  sys_killpg,
+[SYS_nicepg]  sys_nicepg,
+[SYS_logstat] sys_logstat,
+[SYS_mmap]    sys_mmap,
+[SYS_munmap]  sys_munmap,
+[SYS_pipesize] sys_pipesize,
 };
 
+// Call system call num, timing it for sysstat (see sysacct.c).
+static int
+dispatch(int num)
+{
+#if SYSSTAT
+  unsigned long long t0;
+  int ret;
+
+  t0 = rdtsc();
+  ret = syscalls[num]();
+  sysstat_record(num, rdtsc() - t0);
+  return ret;
+#else
+  return syscalls[num]();
+#endif
+}
+
 void
 syscall(void)
 {
@@ -135,10 +209,49 @@ syscall(void)
 
   num = proc->tf->eax;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
-    proc->tf->eax = syscalls[num]();
+    proc->tf->eax = dispatch(num);
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             proc->pid, proc->name, num);
     proc->tf->eax = -1;
   }
 }
+
+// Execute every request queued in the user's sysring with a single
+// trap.  Each request is dispatched through syscalls[] exactly as if
+// it had trapped on its own: tf->esp is pointed at the request so that
+// argint(n) reads req->arg[n] (req->num sits where the return address
+// would be).  Returns the number of requests executed, or -1.
+int
+sys_sysring(void)
+{
+  struct sysring *r;
+  struct sysreq *req;
+  uint esp, n;
+  int num, ret;
+
+  if(argptr(0, (char**)&r, sizeof(*r)) < 0)
+    return -1;
+
+  esp = proc->tf->esp;
+  for(n = 0; r->head != r->tail && n < SYSRING_SIZE && !proc->killed; n++){
+    req = &r->sq[r->head % SYSRING_SIZE];
+    num = req->num;
+    proc->tf->esp = (uint)req;
+    // fork, exec, exit and exitstatus rewrite or abandon the trap
+    // frame, and sysring itself would recurse.
+    if(num > 0 && num < NELEM(syscalls) && syscalls[num] &&
+       num != SYS_fork && num != SYS_exec && num != SYS_exit &&
+       num != SYS_exitstatus && num != SYS_sysring)
+      ret = dispatch(num);
+    else
+      ret = -1;
+    // An sbrk() in the batch may have unmapped the ring itself.
+    if((uint)r + sizeof(*r) > proc->sz)
+      break;
+    r->cq[r->head % SYSRING_SIZE] = ret;
+    r->head++;
+  }
+  proc->tf->esp = esp;
+  return n;
+}
@@ -21,3 +21,30 @@
 #define SYS_mkdir  20
 #define SYS_close  21
 #define SYS_nice   22
+#define SYS_sysring 23
+#define SYS_lockstat 24
+#define SYS_yield  25
+#define SYS_procsnap 26
+#define SYS_clock_cycles 27
+#define SYS_nanouptime 28
+#define SYS_grpcreate 29
+#define SYS_grpjoin 30
+#define SYS_rtsched 31
+#define SYS_deadline 32
+#define SYS_cpustat 33
+#define SYS_clone 34
+#define SYS_join 35
+#define SYS_futex_wait 36
+#define SYS_futex_wake 37
+#define SYS_sysstat 38
+#define SYS_profctl 39
+#define SYS_profread 40
+#define SYS_exitstatus 41
+#define SYS_waitn 42
+#define SYS_setpgid 43
+#define SYS_killpg 44
+#define SYS_nicepg 45
+#define SYS_logstat 46
+#define SYS_mmap 47
+#define SYS_munmap 48
+#define SYS_pipesize 49
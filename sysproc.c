@@ -8,10 +8,38 @@
 #include "proc.h"
 
 #include "spinlock.h"
-extern struct {
-    struct spinlock lock;
-    struct proc proc[NPROC];
-} ptable;
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "lockstat.h"
+#include "pstat.h"
+#include "tsc.h"
+#include "sysstat.h"
+#include "prof.h"
+#include "wait.h"
+#include "logstat.h"
+#include "mmap.h"
+
+// proc.c
+int set_nice(int, int);
+int procsnap(struct pstat*, int);
+int grpcreate(int);
+int grpjoin(int, int);
+int rtsched(int, int, int, int);
+int deadline(int, int);
+int cpustat(struct cpustat*, int);
+int clone(void (*)(void*), void*, void*);
+int join(void**);
+int futex_wait(int*, int);
+int futex_wake(int*, int);
+int waitn(int*, int*, int, int);
+int setpgid(int, int);
+int killpg(int);
+int nicepg(int, int);
+void sched_yield(void);
+
+// pipe.c
+int pipesize(struct pipe*, int);
 
 int
 sys_fork(void)
@@ -42,6 +70,13 @@ sys_kill(void)
   return kill(pid);
 }
 
+int
+sys_yield(void)
+{
+  sched_yield();
+  return 0;
+}
+
 int
 sys_getpid(void)
 {
@@ -70,51 +105,359 @@ sys_sleep(void)
 
   if(argint(0, &n) < 0)
     return -1;
-  acquire(&tickslock);
+  lockstat_acquire(&tickslock);
   ticks0 = ticks;
   while(ticks - ticks0 < n){
     if(proc->killed){
-      release(&tickslock);
+      lockstat_release(&tickslock);
       return -1;
     }
     sleep(&ticks, &tickslock);
   }
-  release(&tickslock);
+  lockstat_release(&tickslock);
   return 0;
 }
 
 // return how many clock tick interrupts have occurred
-// since start.
+// since start.  ticks is a single aligned word that only
+// the timer interrupt writes, so it can be read without
+// taking tickslock (and without contending with the tick).
 int
 sys_uptime(void)
 {
-  uint xticks;
+  return *(volatile uint*)&ticks;
+}
+
+// Store the raw rdtsc cycle count in *c.
+int
+sys_clock_cycles(void)
+{
+  unsigned long long *c;
 
-  acquire(&tickslock);
-  xticks = ticks;
-  release(&tickslock);
-  return xticks;
+  if(argptr(0, (char**)&c, sizeof(*c)) < 0)
+    return -1;
+  *c = rdtsc();
+  return 0;
+}
+
+// Store nanoseconds since boot in *ns, from the TSC
+// calibrated against the timer at boot.
+int
+sys_nanouptime(void)
+{
+  unsigned long long *ns;
+
+  if(argptr(0, (char**)&ns, sizeof(*ns)) < 0)
+    return -1;
+  *ns = nanouptime();
+  return 0;
 }
 
 int
 sys_nice(void) {
     int pid, new_value;
-    struct proc *p;
 
     // Fetch the arguments from the syscall
     if (argint(0, &pid) < 0 || argint(1, &new_value) < 0)
         return -1;
 
-    // Find the process with the given PID
-    acquire(&ptable.lock);
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-        if (p->pid == pid) {
-            int old_value = p->nice;  // Store old nice value
-            p->nice = new_value;      // Update with new value
-            release(&ptable.lock);
-            return old_value;         // Return the old nice value
-        }
-    }
-    release(&ptable.lock);
-    return -1;  // PID not found
+    // set_nice() checks the range and moves the process to its new
+    // priority queue
+    return set_nice(pid, new_value);  // Old nice value, or -1 if PID not found or value out of range
+}
+
+// Copy spinlock statistics into the user buffer and
+// optionally reset them.  Returns the number of locks.
+int
+sys_lockstat(void)
+{
+  struct lockstat *st;
+  int n, reset;
+
+  if(argint(1, &n) < 0 || argint(2, &reset) < 0)
+    return -1;
+  if(n < 0 || n > NLOCKSTAT || argptr(0, (char**)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return lockstat_read(st, n, reset);
+}
+
+// Copy the file-system log statistics into the user buffer and
+// optionally reset them.
+int
+sys_logstat(void)
+{
+  struct logstat *st;
+  int reset;
+
+  if(argptr(0, (char**)&st, sizeof(*st)) < 0 || argint(1, &reset) < 0)
+    return -1;
+  return logstat_read(st, reset);
+}
+
+// Copy consistent snapshots of up to n processes into the
+// user buffer without taking ptable.lock.  Returns the count.
+int
+sys_procsnap(void)
+{
+  struct pstat *ps;
+  int n;
+
+  if(argint(1, &n) < 0)
+    return -1;
+  if(n < 0 || n > NPROC || argptr(0, (char**)&ps, n*sizeof(*ps)) < 0)
+    return -1;
+  return procsnap(ps, n);
+}
+
+// Create a scheduling group with the given CPU shares
+// and move the caller into it.  Returns the group id.
+int
+sys_grpcreate(void)
+{
+  int shares;
+
+  if(argint(0, &shares) < 0)
+    return -1;
+  return grpcreate(shares);
+}
+
+// Move process pid into scheduling group gid.
+int
+sys_grpjoin(void)
+{
+  int pid, gid;
+
+  if(argint(0, &pid) < 0 || argint(1, &gid) < 0)
+    return -1;
+  return grpjoin(pid, gid);
+}
+
+// Admit process pid to the real-time class at priority prio with
+// a budget of budget ticks per period ticks; prio 0 leaves it.
+int
+sys_rtsched(void)
+{
+  int pid, prio, budget, period;
+
+  if(argint(0, &pid) < 0 || argint(1, &prio) < 0 ||
+     argint(2, &budget) < 0 || argint(3, &period) < 0)
+    return -1;
+  return rtsched(pid, prio, budget, period);
+}
+
+// Reserve runtime ticks every period ticks for the caller,
+// scheduled earliest deadline first.
+int
+sys_deadline(void)
+{
+  int runtime, period;
+
+  if(argint(0, &runtime) < 0 || argint(1, &period) < 0)
+    return -1;
+  return deadline(runtime, period);
+}
+
+// Copy statistics for up to n CPUs into the user buffer.
+// Returns the number of CPUs.
+int
+sys_cpustat(void)
+{
+  struct cpustat *st;
+  int n;
+
+  if(argint(1, &n) < 0)
+    return -1;
+  if(n < 0 || n > NCPU || argptr(0, (char**)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return cpustat(st, n);
+}
+
+// Create a thread sharing the caller's address space that runs
+// fn(arg) on the one-page user stack stack.
+int
+sys_clone(void)
+{
+  int fn, arg;
+  char *stack;
+
+  if(argint(0, &fn) < 0 || argint(1, &arg) < 0 ||
+     argptr(2, &stack, PGSIZE) < 0)
+    return -1;
+  return clone((void(*)(void*))fn, (void*)arg, stack);
+}
+
+// Wait for a thread to exit; store its stack in *stack.
+int
+sys_join(void)
+{
+  void **stack;
+
+  if(argptr(0, (char**)&stack, sizeof(*stack)) < 0)
+    return -1;
+  return join(stack);
+}
+
+// Sleep on the user word addr if it still holds val.
+int
+sys_futex_wait(void)
+{
+  int *addr, val;
+
+  if(argptr(0, (char**)&addr, sizeof(*addr)) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futex_wait(addr, val);
+}
+
+// Wake up to n sleepers on the user word addr.
+int
+sys_futex_wake(void)
+{
+  int *addr, n;
+
+  if(argptr(0, (char**)&addr, sizeof(*addr)) < 0 || argint(1, &n) < 0)
+    return -1;
+  return futex_wake(addr, n);
+}
+
+// Copy per-system-call statistics into the user buffer, optionally
+// reset them, and if pid >= 0 account only for pid (0: everyone).
+// Returns the number of entries.
+int
+sys_sysstat(void)
+{
+  struct sysstat *st;
+  int n, reset, pid;
+
+  if(argint(1, &n) < 0 || argint(2, &reset) < 0 || argint(3, &pid) < 0)
+    return -1;
+  if(n < 0 || n > NSYSCALL || argptr(0, (char**)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return sysstat_read(st, n, reset, pid);
+}
+
+// Sample process pid (0: everything) every div timer ticks,
+// or stop if div is 0.
+int
+sys_profctl(void)
+{
+  int pid, div;
+
+  if(argint(0, &pid) < 0 || argint(1, &div) < 0)
+    return -1;
+  return profctl(pid, div);
+}
+
+// Move up to n profiler samples into the user buffer.
+int
+sys_profread(void)
+{
+  struct profsample *buf;
+  int n;
+
+  if(argint(1, &n) < 0)
+    return -1;
+  if(n < 0 || n > NCPU*NPROFBUF || argptr(0, (char**)&buf, n*sizeof(*buf)) < 0)
+    return -1;
+  return profread(buf, n);
+}
+
+// Exit with the given status, which the parent collects with waitn().
+int
+sys_exitstatus(void)
+{
+  int status;
+
+  if(argint(0, &status) < 0)
+    return -1;
+  proc->xstate = status;
+  exit();
+  return 0;  // not reached
+}
+
+// Reap up to max exited children into pids[] and statuses[].
+int
+sys_waitn(void)
+{
+  int *pids, *statuses, max, flags;
+
+  if(argint(2, &max) < 0 || argint(3, &flags) < 0 || max < 1 || max > NPROC)
+    return -1;
+  if(argptr(0, (char**)&pids, max*sizeof(int)) < 0 ||
+     argptr(1, (char**)&statuses, max*sizeof(int)) < 0)
+    return -1;
+  return waitn(pids, statuses, max, flags);
+}
+
+int
+sys_setpgid(void)
+{
+  int pid, pgid;
+
+  if(argint(0, &pid) < 0 || argint(1, &pgid) < 0)
+    return -1;
+  return setpgid(pid, pgid);
+}
+
+int
+sys_killpg(void)
+{
+  int pgid;
+
+  if(argint(0, &pgid) < 0)
+    return -1;
+  return killpg(pgid);
+}
+
+int
+sys_nicepg(void)
+{
+  int pgid, value;
+
+  if(argint(0, &pgid) < 0 || argint(1, &value) < 0)
+    return -1;
+  return nicepg(pgid, value);
+}
+
+// Map a file: mmap(fd, off, len, prot).  Returns the address,
+// or -1.  Pages are read in on first touch (see mmap.c).
+int
+sys_mmap(void)
+{
+  int fd, off, len, prot;
+  struct file *f;
+  uint addr;
+
+  if(argint(0, &fd) < 0 || argint(1, &off) < 0 ||
+     argint(2, &len) < 0 || argint(3, &prot) < 0)
+    return -1;
+  if(fd < 0 || fd >= NOFILE || (f = proc->ofile[fd]) == 0)
+    return -1;
+  if((addr = vmamap(f, off, len, prot)) == 0)
+    return -1;
+  return addr;
+}
+
+int
+sys_munmap(void)
+{
+  int addr, len;
+
+  if(argint(0, &addr) < 0 || argint(1, &len) < 0)
+    return -1;
+  return vmaunmap(addr, len);
+}
+
+// Resize the ring of the pipe open on fd to hold at least size
+// bytes.  The pipe must be empty.  Returns the new capacity, or -1.
+int
+sys_pipesize(void)
+{
+  int fd, size;
+  struct file *f;
+
+  if(argint(0, &fd) < 0 || argint(1, &size) < 0)
+    return -1;
+  if(fd < 0 || fd >= NOFILE || (f = proc->ofile[fd]) == 0 || f->type != FD_PIPE)
+    return -1;
+  return pipesize(f->pipe, size);
 }
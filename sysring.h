@@ -0,0 +1,19 @@
+// Shared-memory system call ring.
+// User space fills sq[tail % SYSRING_SIZE] and advances tail; one
+// sysring() call executes every queued request through syscalls[]
+// and leaves each return value in the matching cq[] slot.
+
+#define SYSRING_SIZE  64   // slots in the ring
+#define SYSRING_NARG   5   // max arguments per request
+
+struct sysreq {
+  int num;                 // System call number (SYS_*)
+  int arg[SYSRING_NARG];   // Must directly follow num; see sys_sysring()
+};
+
+struct sysring {
+  uint head;                      // Next request the kernel runs
+  uint tail;                      // Next free slot for user space
+  struct sysreq sq[SYSRING_SIZE]; // Submission queue
+  int cq[SYSRING_SIZE];           // Completion queue (return values)
+};
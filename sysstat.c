@@ -0,0 +1,159 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+#include "sysstat.h"
+
+// Print the system calls that took the most time, from the kernel's
+// per-system-call accounting (see sysacct.c).
+//   sysstat [-r] [-n top] [-p pid]   print counts since the last reset
+//                                    (-r resets afterwards; -p pid
+//                                    accounts only for pid from now on,
+//                                    0 for every process)
+//   sysstat [-n top] cmd args...     reset, run cmd, print its counts
+// Latencies are in rdtsc cycles; p50 and p99 are the lower bounds of
+// their log2 histogram buckets.
+
+static char *names[NSYSCALL] = {
+[SYS_fork]    "fork",
+[SYS_exit]    "exit",
+[SYS_wait]    "wait",
+[SYS_pipe]    "pipe",
+[SYS_read]    "read",
+[SYS_kill]    "kill",
+[SYS_exec]    "exec",
+[SYS_fstat]   "fstat",
+[SYS_chdir]   "chdir",
+[SYS_dup]     "dup",
+[SYS_getpid]  "getpid",
+[SYS_sbrk]    "sbrk",
+[SYS_sleep]   "sleep",
+[SYS_uptime]  "uptime",
+[SYS_open]    "open",
+[SYS_write]   "write",
+[SYS_mknod]   "mknod",
+[SYS_unlink]  "unlink",
+[SYS_link]    "link",
+[SYS_mkdir]   "mkdir",
+[SYS_close]   "close",
+[SYS_nice]    "nice",
+[SYS_sysring] "sysring",
+[SYS_lockstat] "lockstat",
+[SYS_yield]   "yield",
+[SYS_procsnap] "procsnap",
+[SYS_clock_cycles] "clock_cycles",
+[SYS_nanouptime] "nanouptime",
+[SYS_grpcreate] "grpcreate",
+[SYS_grpjoin] "grpjoin",
+[SYS_rtsched] "rtsched",
+[SYS_deadline] "deadline",
+[SYS_cpustat] "cpustat",
+[SYS_clone]   "clone",
+[SYS_join]    "join",
+[SYS_futex_wait] "futex_wait",
+[SYS_futex_wake] "futex_wake",
+[SYS_sysstat] "sysstat",
+[SYS_profctl] "profctl",
+[SYS_profread] "profread",
+[SYS_exitstatus] "exitstatus",
+[SYS_waitn]   "waitn",
+[SYS_setpgid] "setpgid",
+[SYS_killpg]  "killpg",
+[SYS_nicepg]  "nicepg",
+[SYS_logstat] "logstat",
+[SYS_mmap]    "mmap",
+[SYS_munmap]  "munmap",
+[SYS_pipesize] "pipesize",
+};
+
+static struct sysstat st[NSYSCALL];
+
+// Lower bound of the bucket holding the pct'th percentile of s.
+static uint
+percentile(struct sysstat *s, int pct)
+{
+  uint seen, want;
+  int i;
+
+  want = s->count * pct / 100;
+  seen = 0;
+  for(i = 0; i < NSYSHIST; i++){
+    seen += s->hist[i];
+    if(seen > want)
+      break;
+  }
+  if(i == NSYSHIST)
+    i = NSYSHIST - 1;
+  return i ? 1u << i : 0;
+}
+
+// Average latency of s.  User programs have no 64-bit division
+// (no libgcc), so scale the total down until it fits in 32 bits.
+static uint
+average(struct sysstat *s)
+{
+  unsigned long long c;
+  int shift;
+
+  for(c = s->cycles, shift = 0; c >> 32; c >>= 1, shift++)
+    ;
+  return ((uint)c / s->count) << shift;
+}
+
+static void
+print(int top)
+{
+  int i, best, done[NSYSCALL];
+
+  memset(done, 0, sizeof(done));
+  printf(1, "syscall count kcycles avg p50 p99\n");
+  while(top-- > 0){
+    best = -1;
+    for(i = 0; i < NSYSCALL; i++)
+      if(!done[i] && st[i].count && (best < 0 || st[i].cycles > st[best].cycles))
+        best = i;
+    if(best < 0)
+      break;
+    done[best] = 1;
+    printf(1, "%s %d %d %d %d %d\n", names[best] ? names[best] : "?",
+           st[best].count, (uint)(st[best].cycles >> 10), average(&st[best]),
+           percentile(&st[best], 50), percentile(&st[best], 99));
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int i, top = 10, reset = 0, pid = -1;
+
+  for(i = 1; i < argc && argv[i][0] == '-'; i++){
+    if(strcmp(argv[i], "-r") == 0)
+      reset = 1;
+    else if(strcmp(argv[i], "-n") == 0 && i+1 < argc)
+      top = atoi(argv[++i]);
+    else if(strcmp(argv[i], "-p") == 0 && i+1 < argc)
+      pid = atoi(argv[++i]);
+    else {
+      printf(2, "usage: sysstat [-r] [-n top] [-p pid] [cmd args...]\n");
+      exit();
+    }
+  }
+
+  if(i < argc){
+    sysstat(st, NSYSCALL, 1, -1);
+    if(fork() == 0){
+      exec(argv[i], argv + i);
+      printf(2, "sysstat: exec %s failed\n", argv[i]);
+      exit();
+    }
+    wait();
+    reset = 0;
+  }
+
+  if(sysstat(st, NSYSCALL, reset, pid) < 0){
+    printf(2, "sysstat: not available (SYSSTAT is 0 in sysstat.h)\n");
+    exit();
+  }
+  print(top);
+  exit();
+}
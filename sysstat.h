@@ -0,0 +1,22 @@
+// Per-system-call accounting.
+// Set SYSSTAT to 0 to stop timing system calls in syscall().
+#define SYSSTAT 1
+
+#define NSYSCALL  64  // system call numbers tracked, 0..NSYSCALL-1
+#define NSYSHIST  32  // latency histogram buckets
+
+// Statistics for one system call number, as returned by the
+// sysstat() system call (summed over CPUs).
+struct sysstat {
+  uint count;                   // Calls
+  unsigned long long cycles;    // Total latency, in rdtsc cycles
+  uint hist[NSYSHIST];          // hist[i]: calls taking 2^i..2^(i+1)-1 cycles
+};
+
+// sysacct.c
+#if SYSSTAT
+void sysstat_record(int, unsigned long long);
+int sysstat_read(struct sysstat*, int, int, int);
+#else
+#define sysstat_read(st, n, reset, pid) (-1)
+#endif
@@ -0,0 +1,141 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "div64.h"
+#include "param.h"
+#include "pstat.h"
+
+// Threads against processes.
+//   threadbench create ...  n thread_create/thread_join pairs against
+//                           n fork/wait pairs, in ns per pair
+//   threadbench switch ...  two threads against two processes yielding
+//                           to each other for ticks ticks; samevm is
+//                           the number of switches that kept cr3
+//
+// Usage: threadbench [n [ticks]]
+
+static volatile int go, stop;
+static volatile int count[2];
+static struct cpustat st[NCPU];
+
+static uint
+samevm(void)
+{
+  int i, n;
+  uint sum;
+
+  n = cpustat(st, NCPU);
+  sum = 0;
+  for(i = 0; i < n; i++)
+    sum += st[i].nsamevm;
+  return sum;
+}
+
+static void
+nothing(void *arg)
+{
+  exit();
+}
+
+static void
+yielder(void *arg)
+{
+  int i = (int)arg;
+
+  while(!go)
+    yield();
+  while(!stop){
+    count[i]++;
+    yield();
+  }
+  exit();
+}
+
+static void
+create(int n)
+{
+  int i;
+  unsigned long long t0, tthread, tproc;
+
+  t0 = nsnow();
+  for(i = 0; i < n; i++){
+    if(thread_create(nothing, 0) < 0){
+      printf(2, "threadbench: thread_create failed\n");
+      exit();
+    }
+    thread_join();
+  }
+  tthread = nsnow() - t0;
+
+  t0 = nsnow();
+  for(i = 0; i < n; i++){
+    if(fork() == 0)
+      exit();
+    wait();
+  }
+  tproc = nsnow() - t0;
+
+  printf(1, "threadbench create n=%d thread=%d process=%d unit=ns\n",
+         n, (uint)div64(tthread, n, 0), (uint)div64(tproc, n, 0));
+}
+
+static void
+switches(int ticks)
+{
+  int fd[2], i, n, end, threads;
+  uint vm0, vm1;
+
+  // Threads share count[] with us.
+  count[0] = count[1] = 0;
+  go = stop = 0;
+  thread_create(yielder, (void*)0);
+  thread_create(yielder, (void*)1);
+  vm0 = samevm();
+  go = 1;
+  sleep(ticks);
+  stop = 1;
+  thread_join();
+  thread_join();
+  vm1 = samevm();
+  threads = count[0] + count[1];
+
+  // Processes report their counts through a pipe.
+  pipe(fd);
+  end = uptime() + 2 + ticks;
+  for(i = 0; i < 2; i++){
+    if(fork() == 0){
+      close(fd[0]);
+      while(uptime() < end - ticks)
+        yield();
+      for(n = 0; uptime() < end; n++)
+        yield();
+      write(fd[1], &n, sizeof(n));
+      exit();
+    }
+  }
+  close(fd[1]);
+  count[0] = 0;
+  for(i = 0; i < 2; i++){
+    if(read(fd[0], &n, sizeof(n)) == sizeof(n))
+      count[0] += n;
+    wait();
+  }
+  close(fd[0]);
+
+  printf(1, "threadbench switch ticks=%d thread=%d process=%d samevm=%d\n",
+         ticks, threads, count[0], vm1 - vm0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = 200, ticks = 100;
+
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(argc > 2)
+    ticks = atoi(argv[2]);
+  create(n);
+  switches(ticks);
+  exit();
+}
@@ -0,0 +1,91 @@
+// Ticket locks.
+// Same rules as spinlocks (interrupts off while held, no sleeping),
+// but fair: CPUs get the lock in the order they asked for it.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "memlayout.h"
+#include "mmu.h"
+#include "proc.h"
+#include "ticketlock.h"
+#include "lockstat.h"
+#include "tsc.h"
+
+void
+initticketlock(struct ticketlock *lk, char *name)
+{
+  lk->name = name;
+  lk->next = 0;
+  lk->owner = 0;
+  lk->cpu = 0;
+}
+
+// Acquire the lock.
+// Spins until this CPU's ticket comes up.
+void
+tacquire(struct ticketlock *lk)
+{
+  uint ticket;
+#if LOCKSTAT
+  unsigned long long t0;
+  uint pcs[10];
+  int busy;
+#endif
+
+  pushcli(); // disable interrupts to avoid deadlock.
+  if(tholding(lk))
+    panic("tacquire");
+
+  // The atomic add hands out each ticket exactly once.
+  ticket = __sync_fetch_and_add(&lk->next, 1);
+#if LOCKSTAT
+  busy = lk->owner != ticket;
+  t0 = rdtsc();
+#endif
+  while(lk->owner != ticket)
+    asm volatile("pause");
+
+  // Tell the C compiler and the processor to not move loads or stores
+  // past this point, to ensure that the critical section's memory
+  // references happen after the lock is acquired.
+  __sync_synchronize();
+
+  lk->cpu = cpu;
+#if LOCKSTAT
+  pcs[0] = 0;
+  if(busy)
+    getcallerpcs(&lk, pcs);
+  lockstat_acquired(lk, busy, rdtsc() - t0, pcs[0]);
+#endif
+}
+
+// Release the lock to the next ticket holder.
+void
+trelease(struct ticketlock *lk)
+{
+  if(!tholding(lk))
+    panic("trelease");
+
+#if LOCKSTAT
+  lockstat_releasing(lk);
+#endif
+  lk->cpu = 0;
+
+  // Make the critical section's stores visible before the
+  // next ticket holder can see the lock as free.
+  __sync_synchronize();
+
+  // Only the holder writes owner, so a plain store suffices.
+  lk->owner = lk->owner + 1;
+
+  popcli();
+}
+
+// Check whether this cpu is holding the lock.
+int
+tholding(struct ticketlock *lk)
+{
+  return lk->owner != lk->next && lk->cpu == cpu;
+}
@@ -0,0 +1,17 @@
+// Ticket lock: a FIFO spinlock.  Each acquirer takes the next
+// ticket and spins until owner reaches it, so waiters are served
+// in arrival order and only read the lock word while spinning.
+struct ticketlock {
+  volatile uint next;    // Next ticket to hand out
+  volatile uint owner;   // Ticket currently allowed to hold the lock
+
+  // For debugging:
+  char *name;            // Name of lock.
+  struct cpu *cpu;       // The cpu holding the lock.
+};
+
+// ticketlock.c
+void initticketlock(struct ticketlock*, char*);
+void tacquire(struct ticketlock*);
+void trelease(struct ticketlock*);
+int tholding(struct ticketlock*);
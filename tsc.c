@@ -0,0 +1,64 @@
+// Calibrated time-stamp counter.
+//
+// The timer interrupt fires every TICK_NS nanoseconds (lapic.c
+// programs the lapic timer for roughly 10 ms), which is too coarse
+// for benchmarks.  tscinit() counts rdtsc cycles over CALIBTICKS
+// ticks once at boot, and nanouptime() scales the cycle count by
+// that rate.  The TSCs of all CPUs are assumed to run in step.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "tsc.h"
+#include "div64.h"
+
+#define TICK_NS    10000000  // nominal timer period
+#define CALIBTICKS 10        // ticks to calibrate over
+
+uint cyclespertick;   // rdtsc cycles per timer tick; 0 until tscinit()
+static unsigned long long tsc0;  // rdtsc at the start of tick tick0
+static uint tick0;
+
+// Measure the TSC rate against the timer interrupt.
+// Needs interrupts on, so it runs in the first process (see forkret).
+void
+tscinit(void)
+{
+  volatile uint *t = &ticks;
+  uint start;
+
+  // Start on a tick edge so the interval is whole ticks.
+  start = *t;
+  while(*t == start)
+    ;
+  tick0 = *t;
+  tsc0 = rdtsc();
+  while(*t - tick0 < CALIBTICKS)
+    ;
+  cyclespertick = div64(rdtsc() - tsc0, CALIBTICKS, 0);
+}
+
+// Convert a cycle count to nanoseconds.
+unsigned long long
+cycles2ns(unsigned long long c)
+{
+  unsigned long long whole;
+  uint part;
+
+  if(cyclespertick == 0)
+    return 0;
+  // Split into whole ticks and the remainder so that nothing
+  // overflows 64 bits for any realistic uptime.
+  whole = div64(c, cyclespertick, &part);
+  return whole * TICK_NS +
+         div64((unsigned long long)part * TICK_NS, cyclespertick, 0);
+}
+
+// Nanoseconds since boot.  Before calibration this is ticks-based.
+unsigned long long
+nanouptime(void)
+{
+  if(cyclespertick == 0)
+    return (unsigned long long)ticks * TICK_NS;
+  return (unsigned long long)tick0 * TICK_NS + cycles2ns(rdtsc() - tsc0);
+}
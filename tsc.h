@@ -0,0 +1,16 @@
+// Time-stamp counter.
+
+static inline unsigned long long
+rdtsc(void)
+{
+  unsigned long long t;
+
+  asm volatile("rdtsc" : "=A" (t));
+  return t;
+}
+
+// tsc.c
+extern uint cyclespertick;
+void tscinit(void);
+unsigned long long cycles2ns(unsigned long long);
+unsigned long long nanouptime(void);
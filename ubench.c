@@ -0,0 +1,29 @@
+#include "types.h"
+#include "user.h"
+
+// Helpers shared by the benchmark programs.
+
+// Sort a[0..n) in place, ascending.  Insertion sort: benchmarks
+// sort at most a few thousand samples.
+void
+sort(int *a, int n)
+{
+  int i, j, v;
+
+  for(i = 1; i < n; i++){
+    v = a[i];
+    for(j = i; j > 0 && a[j-1] > v; j--)
+      a[j] = a[j-1];
+    a[j] = v;
+  }
+}
+
+// Nanoseconds since boot.
+unsigned long long
+nsnow(void)
+{
+  unsigned long long ns;
+
+  nanouptime(&ns);
+  return ns;
+}
@@ -0,0 +1,76 @@
+#include "types.h"
+#include "user.h"
+#include "ulock.h"
+
+// Mutex and condition variable for threads (see clone()).
+// An uncontended lock or unlock is one atomic instruction in user
+// space; the kernel is entered only to sleep while the mutex is held
+// and to wake a sleeper on unlock.
+
+void
+mutex_init(struct mutex *m)
+{
+  m->state = 0;
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  int c;
+
+  if((c = __sync_val_compare_and_swap(&m->state, 0, 1)) == 0)
+    return;
+  // Contended: mark the mutex as having waiters, then sleep until
+  // we are the one to take it.  Taking it with state 2 is safe:
+  // at worst unlock makes one futex_wake() call too many.
+  if(c != 2)
+    c = __sync_lock_test_and_set(&m->state, 2);
+  while(c != 0){
+    futex_wait((int*)&m->state, 2);
+    c = __sync_lock_test_and_set(&m->state, 2);
+  }
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(__sync_fetch_and_sub(&m->state, 1) != 1){
+    m->state = 0;
+    futex_wake((int*)&m->state, 1);
+  }
+}
+
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+// Atomically release m and wait for a signal; reacquire m.
+// As with any condition variable, recheck the predicate on return.
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  int seq;
+
+  seq = c->seq;
+  mutex_unlock(m);
+  futex_wait((int*)&c->seq, seq);
+  // Others may be waiting for m too, so take it as contended.
+  while(__sync_lock_test_and_set(&m->state, 2) != 0)
+    futex_wait((int*)&m->state, 2);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake((int*)&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  __sync_fetch_and_add(&c->seq, 1);
+  futex_wake((int*)&c->seq, 0x7fffffff);  // all of them
+}
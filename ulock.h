@@ -0,0 +1,10 @@
+// User-space mutex and condition variable on futex_wait/futex_wake
+// (see ulock.c).  Zero-filled structures are unlocked / unsignalled.
+
+struct mutex {
+  volatile int state;   // 0 unlocked, 1 locked, 2 locked with waiters
+};
+
+struct cond {
+  volatile int seq;     // Bumped by every signal and broadcast
+};
@@ -0,0 +1,19 @@
+// Read-only pages the kernel maps into every process, just below
+// KERNBASE, so that getpid() and uptime() need no system call.
+#define UTIME  0x7FFFF000  // struct utime, one page shared by all
+#define UPROC  0x7FFFE000  // struct uproc, one page per address space
+
+struct utime {
+  uint ticks;  // Copy of ticks, updated by the timer interrupt
+};
+
+struct uproc {
+  int pid;     // Owner's pid; 0 while clone() threads share the page
+};
+
+// vm.c
+int setupupage(pde_t*, int);
+void setupid(pde_t*, int);
+
+// trap.c
+extern struct utime *utimepage;
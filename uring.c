@@ -0,0 +1,46 @@
+#include "types.h"
+#include "user.h"
+#include "sysring.h"
+
+// User-side helpers for the system call ring (see sysring.h).
+
+void
+ringinit(struct sysring *r)
+{
+  memset(r, 0, sizeof(*r));
+}
+
+// Queue system call num with up to three arguments.
+// Returns the slot whose cq[] entry will hold the result,
+// or -1 if the ring is full.
+int
+ringpush(struct sysring *r, int num, int a0, int a1, int a2)
+{
+  struct sysreq *req;
+  int slot;
+
+  if(r->tail - r->head >= SYSRING_SIZE)
+    return -1;
+  slot = r->tail % SYSRING_SIZE;
+  req = &r->sq[slot];
+  req->num = num;
+  req->arg[0] = a0;
+  req->arg[1] = a1;
+  req->arg[2] = a2;
+  r->tail++;
+  return slot;
+}
+
+// Run everything queued so far with one trap.
+// Returns the number of requests the kernel executed.
+int
+ringsubmit(struct sysring *r)
+{
+  return sysring(r);
+}
+
+int
+ringresult(struct sysring *r, int slot)
+{
+  return r->cq[slot];
+}
@@ -1,5 +1,14 @@
 struct stat;
 struct rtcdate;
+struct sysring;
+struct lockstat;
+struct pstat;
+struct cpustat;
+struct mutex;
+struct cond;
+struct sysstat;
+struct profsample;
+struct logstat;
 
 // system calls
 int fork(void);
@@ -19,11 +28,38 @@ int link(char*, char*);
 int mkdir(char*);
 int chdir(char*);
 int dup(int);
-int getpid(void);
+int sysgetpid(void);
 char* sbrk(int);
 int sleep(int);
-int uptime(void);
+int sysuptime(void);
 int nice(int pid, int value);
+int sysring(struct sysring*);
+int lockstat(struct lockstat*, int, int);
+int yield(void);
+int procsnap(struct pstat*, int);
+int clock_cycles(unsigned long long*);
+int nanouptime(unsigned long long*);
+int grpcreate(int);
+int grpjoin(int, int);
+int rtsched(int pid, int prio, int budget, int period);
+int deadline(int runtime, int period);
+int cpustat(struct cpustat*, int);
+int clone(void (*fn)(void*), void *arg, void *stack);
+int join(void **stack);
+int futex_wait(int *addr, int val);
+int futex_wake(int *addr, int n);
+int sysstat(struct sysstat*, int, int, int);
+int profctl(int pid, int div);
+int profread(struct profsample*, int);
+int exitstatus(int) __attribute__((noreturn));
+int waitn(int *pids, int *statuses, int max, int flags);
+int setpgid(int pid, int pgid);
+int killpg(int pgid);
+int nicepg(int pgid, int value);
+int logstat(struct logstat*, int reset);
+void* mmap(int fd, uint off, uint len, int prot);
+int munmap(void *addr, uint len);
+int pipesize(int fd, int size);
 
 // ulib.c
 int stat(char*, struct stat*);
@@ -38,3 +74,30 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+
+// uring.c
+void ringinit(struct sysring*);
+int ringpush(struct sysring*, int, int, int, int);
+int ringsubmit(struct sysring*);
+int ringresult(struct sysring*, int);
+
+// uthread.c
+int thread_create(void (*)(void*), void*);
+int thread_join(void);
+
+// ulock.c
+void mutex_init(struct mutex*);
+void mutex_lock(struct mutex*);
+void mutex_unlock(struct mutex*);
+void cond_init(struct cond*);
+void cond_wait(struct cond*, struct mutex*);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
+
+// ubench.c
+void sort(int*, int);
+unsigned long long nsnow(void);
+
+// upage.c
+int getpid(void);
+int uptime(void);
@@ -0,0 +1,36 @@
+#include "types.h"
+#include "user.h"
+
+// User-side thread helpers on top of clone() and join().
+// Each thread gets a one-page stack from malloc(), freed again by
+// thread_join().  umalloc is not thread-safe, so create and join
+// threads from one thread only.
+
+#define TSTACK 4096  // clone() stack size: one page
+
+// Start a thread running fn(arg).  Returns its pid, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  void *stack;
+  int pid;
+
+  if((stack = malloc(TSTACK)) == 0)
+    return -1;
+  if((pid = clone(fn, arg, stack)) < 0)
+    free(stack);
+  return pid;
+}
+
+// Wait for a thread to exit and free its stack.
+// Returns its pid, or -1 if there are no threads.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) >= 0)
+    free(stack);
+  return pid;
+}
@@ -0,0 +1,2 @@
+// Flags for waitn().
+#define WNOHANG 1   // Return 0 at once if no child has exited yet
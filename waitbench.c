@@ -0,0 +1,124 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "div64.h"
+#include "wait.h"
+
+// Reaping many short-lived children.
+//   waitbench wait ...   fork n children that exit at once and reap
+//                        them with one wait() each
+//   waitbench waitn ...  the same, reaped with waitn() in batches of
+//                        up to batch; ok=1 if every child's exit
+//                        status (its index, see exitstatus) came back
+//   waitbench nohang ... waitn(WNOHANG) with a child still running
+//                        must return 0 without sleeping
+// Times are ns per child, fork included.
+//
+// Usage: waitbench [n [batch]]
+
+#define MAXBATCH 64
+
+static int seen[1024];
+
+// Fork n children; child i exits with status i.  Fills pidof[i].
+static void
+spawn(int n, int *pidof)
+{
+  int i, pid;
+
+  for(i = 0; i < n; i++){
+    if((pid = fork()) == 0)
+      exitstatus(i);
+    if(pid < 0){
+      printf(2, "waitbench: fork failed\n");
+      exit();
+    }
+    pidof[i] = pid;
+  }
+}
+
+static void
+onebyone(int n, int *pidof)
+{
+  int i;
+  unsigned long long t0, t;
+
+  t0 = nsnow();
+  spawn(n, pidof);
+  for(i = 0; i < n; i++)
+    wait();
+  t = nsnow() - t0;
+  printf(1, "waitbench wait n=%d per_child=%d unit=ns\n", n, (uint)div64(t, n, 0));
+}
+
+static void
+batched(int n, int batch, int *pidof)
+{
+  int pids[MAXBATCH], statuses[MAXBATCH];
+  int i, k, got, ok;
+  unsigned long long t0, t;
+
+  t0 = nsnow();
+  spawn(n, pidof);
+  memset(seen, 0, sizeof(seen));
+  ok = 1;
+  for(got = 0; got < n; got += k){
+    if((k = waitn(pids, statuses, batch, 0)) <= 0){
+      ok = 0;
+      break;
+    }
+    for(i = 0; i < k; i++){
+      if(statuses[i] < 0 || statuses[i] >= n || pidof[statuses[i]] != pids[i])
+        ok = 0;
+      else
+        seen[statuses[i]]++;
+    }
+  }
+  t = nsnow() - t0;
+  for(i = 0; i < n; i++)
+    if(seen[i] != 1)
+      ok = 0;
+  printf(1, "waitbench waitn n=%d batch=%d per_child=%d unit=ns ok=%d\n",
+         n, batch, (uint)div64(t, n, 0), ok);
+}
+
+static void
+nohang(void)
+{
+  int fd[2], pid, status, r;
+  char c;
+
+  pipe(fd);
+  if(fork() == 0){
+    close(fd[1]);
+    read(fd[0], &c, 1);
+    exitstatus(7);
+  }
+  close(fd[0]);
+  r = waitn(&pid, &status, 1, WNOHANG);
+  close(fd[1]);  // child's read returns 0 and it exits
+  while(waitn(&pid, &status, 1, 0) == 0)
+    ;
+  printf(1, "waitbench nohang running=%d status=%d ok=%d\n",
+         r, status, r == 0 && status == 7);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int n = 40, batch = 16;
+  static int pidof[1024];
+
+  if(argc > 1)
+    n = atoi(argv[1]);
+  if(argc > 2)
+    batch = atoi(argv[2]);
+  if(n > 1024)
+    n = 1024;
+  if(batch < 1 || batch > MAXBATCH)
+    batch = MAXBATCH;
+  onebyone(n, pidof);
+  batched(n, batch, pidof);
+  nohang();
+  exit();
+}